@@ -0,0 +1,937 @@
+#include "Grid.hpp"
+#include "Solver.hpp"
+#include "Generator.hpp"
+#include "GridFactory.hpp"
+#include "Game.hpp"
+#include "GameStore.hpp"
+#include "BandSolver.hpp"
+#include "LatencyHistogram.hpp"
+#include "PuzzleDatabase.hpp"
+#include "DedupIndex.hpp"
+#include "SolutionCache.hpp"
+#include "BatchSolver.hpp"
+#include "ProcessBatch.hpp"
+#include "SolverClient.hpp"
+#include "SolverDaemon.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Benchmarks for the solver strategies, the generator, game moves, the session store, the puzzle database
+// deduplication, the solution cache, puzzle parsing, worker processes and the solver daemon. Corpora come from fixed
+// generator seeds, so every run (and every machine) measures the same puzzles.
+// Results are written as JSON, optionally compared against a baseline written by an earlier run.
+// The global operator new is replaced by one that counts, so the run also checks that the
+// solve, generate and batch paths stop allocating once warmed up, and that every hint follows from the position.
+
+namespace {
+    std::atomic<std::uint64_t> allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = nullptr;
+    if (::posix_memalign(&memory, std::max(static_cast<std::size_t>(alignment), sizeof(void*)), size ? size : 1) == 0) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Metrics = std::map<std::string, double>;
+
+    struct Corpus {
+        std::string name;
+        std::vector<Grid> puzzles;
+    };
+
+    struct Options {
+        bool quick = false;
+        const char* outputPath = nullptr;
+        const char* baselinePath = nullptr;
+        double tolerance = 0.10;
+    };
+
+    // hardest known puzzles for backtracking and human style solvers
+    const char* const HARD_PUZZLES[] = {
+        "100007090030020008009600500005300900010080002600004000300000010040000007007000300", // AI Escargot
+        "100000002090400050006000700050903000000070000000850040700000600030009080002000001", // Easter Monster
+        "000000039000001005003050800008090006070002000100400000009080050020000600400700000", // Golden Nugget
+        "000000012000000003002300400001800005060070800000009000008500000900040500470006000", // Platinum Blonde
+        "800000000003600000070090200050007000000045700000100030001000068008500010090000400",
+        "000000010400000000020000000000050407008000300001090000300400200050100000000806000", // 17 clues
+        "120400300300010050006000100700090000040603000003002000500080700007000005000000098",
+        "600008940900006100070040000200610000000000200089002000000060005000000030800001600"
+    };
+
+    constexpr Generator::Difficulty DIFFICULTIES[] = {
+        Generator::Difficulty::EASY,
+        Generator::Difficulty::MEDIUM,
+        Generator::Difficulty::HARD,
+        Generator::Difficulty::EXPERT
+    };
+
+    constexpr Solver::Strategy STRATEGIES[] = {
+        Solver::Strategy::BRUTE_FORCE,
+        Solver::Strategy::HUMAN,
+        Solver::Strategy::HYBRID,
+        Solver::Strategy::DLX,
+        Solver::Strategy::BITBOARD
+    };
+
+    const char* difficultyName(Generator::Difficulty difficulty) {
+        switch (difficulty) {
+            case Generator::Difficulty::EASY:   return "easy";
+            case Generator::Difficulty::MEDIUM: return "medium";
+            case Generator::Difficulty::HARD:   return "hard";
+            case Generator::Difficulty::EXPERT: return "expert";
+        }
+        return "unknown";
+    }
+
+    std::uint32_t seedFor(Generator::Difficulty difficulty) {
+        return 20240000u + static_cast<std::uint32_t>(difficulty);
+    }
+
+    std::uint64_t elapsedNanos(Clock::time_point start) {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    void addLatency(Metrics& metrics, const std::string& prefix, const LatencyHistogram& latency, double seconds) {
+        metrics[prefix + ".puzzles_per_sec"] = seconds > 0 ? latency.count() / seconds : 0.0;
+        metrics[prefix + ".p50_us"] = latency.percentile(0.50) / 1000.0;
+        metrics[prefix + ".p99_us"] = latency.percentile(0.99) / 1000.0;
+        metrics[prefix + ".max_us"] = latency.max() / 1000.0;
+    }
+
+    std::vector<Corpus> buildCorpora(const Options& options) {
+        const int perDifficulty = options.quick ? 100 : 2000;
+        const int hardRepeats = options.quick ? 5 : 50;
+
+        std::vector<Corpus> corpora;
+        for (Generator::Difficulty difficulty : DIFFICULTIES) {
+            Generator generator(seedFor(difficulty));
+            Corpus corpus{difficultyName(difficulty), {}};
+            corpus.puzzles.reserve(perDifficulty);
+            for (int i = 0; i < perDifficulty; ++i) {
+                corpus.puzzles.push_back(generator.generate(difficulty));
+            }
+            corpora.push_back(std::move(corpus));
+        }
+
+        Corpus hard{"curated", {}};
+        for (int repeat = 0; repeat < hardRepeats; ++repeat) {
+            for (const char* line : HARD_PUZZLES) {
+                Grid grid;
+                grid.loadFromLine(line, Grid::CELL_COUNT);
+                hard.puzzles.push_back(grid);
+            }
+        }
+        corpora.push_back(std::move(hard));
+        return corpora;
+    }
+
+    void benchSolvers(const std::vector<Corpus>& corpora, Metrics& metrics) {
+        for (Solver::Strategy strategy : STRATEGIES) {
+            for (const Corpus& corpus : corpora) {
+                LatencyHistogram latency;
+                std::size_t solved = 0;
+                const Clock::time_point start = Clock::now();
+                for (const Grid& puzzle : corpus.puzzles) {
+                    Grid grid = puzzle;
+                    const Clock::time_point begin = Clock::now();
+                    solved += Solver::solve(grid, strategy);
+                    latency.record(elapsedNanos(begin));
+                }
+                const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+                const std::string prefix = std::string("solve.") + Solver::strategyName(strategy) + "." + corpus.name;
+                addLatency(metrics, prefix, latency, seconds);
+                metrics[prefix + ".solved"] = static_cast<double>(solved);
+                std::cerr << "  " << prefix << ": " << solved << "/" << corpus.puzzles.size() << " solved\n";
+            }
+        }
+    }
+
+    // one solveAsync at a time, timed from the call until the future is ready. The limits are
+    // generous, so this measures the bounded search plus the hand off to the pool
+    void benchBounded(const std::vector<Corpus>& corpora, Metrics& metrics) {
+        Solver::Limits limits;
+        limits.timeLimit = std::chrono::seconds(10);
+        for (const Corpus& corpus : corpora) {
+            LatencyHistogram latency;
+            std::size_t solved = 0;
+            const Clock::time_point start = Clock::now();
+            for (const Grid& puzzle : corpus.puzzles) {
+                const Clock::time_point begin = Clock::now();
+                solved += Solver::solveAsync(puzzle, limits).get().status == SolveStatus::SOLVED;
+                latency.record(elapsedNanos(begin));
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            const std::string prefix = "solve.async." + corpus.name;
+            addLatency(metrics, prefix, latency, seconds);
+            metrics[prefix + ".solved"] = static_cast<double>(solved);
+        }
+    }
+
+    void benchGenerator(const Options& options, Metrics& metrics) {
+        const int count = options.quick ? 50 : 1000;
+        for (Generator::Difficulty difficulty : DIFFICULTIES) {
+            Generator generator(seedFor(difficulty) + 1);
+            LatencyHistogram latency;
+            const Clock::time_point start = Clock::now();
+            for (int i = 0; i < count; ++i) {
+                const Clock::time_point begin = Clock::now();
+                generator.generate(difficulty);
+                latency.record(elapsedNanos(begin));
+            }
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            addLatency(metrics, std::string("generate.") + difficultyName(difficulty), latency, seconds);
+        }
+
+        // complete grids alone: the default mix of searches and transforms, then a search for every grid
+        const int grids = options.quick ? 200000 : 2000000;
+        std::uint8_t cells[Grid::CELL_COUNT];
+        std::uint64_t checksum = 0;
+        GridFactory factory(seedFor(Generator::Difficulty::EASY) + 4);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < grids; ++i) {
+            factory.next(cells);
+            checksum += cells[i % Grid::CELL_COUNT];
+        }
+        metrics["factory.grids_per_sec"] = grids / (elapsedNanos(start) / 1e9);
+
+        factory.setTransformsPerSearch(1);
+        start = Clock::now();
+        for (int i = 0; i < grids / 10; ++i) {
+            factory.next(cells);
+            checksum += cells[i % Grid::CELL_COUNT];
+        }
+        metrics["factory.search.mean_us"] = elapsedNanos(start) / 1000.0 / (grids / 10);
+        if (checksum == 0) {
+            std::cerr << "  factory grids came back empty\n";
+        }
+    }
+
+    // every round fills all empty cells with their solution digits, undoes all moves and redoes them,
+    // then hint walks measure nextHint
+    void benchGame(const Options& options, Metrics& metrics) {
+        const int rounds = options.quick ? 500 : 5000;
+        Generator generator(seedFor(Generator::Difficulty::MEDIUM) + 2);
+        Grid solution;
+        const Grid puzzle = generator.generate(Generator::Difficulty::MEDIUM, solution);
+
+        std::vector<int> emptyCells;
+        for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+            if (puzzle.cellValue(index) == Grid::EMPTY) {
+                emptyCells.push_back(index);
+            }
+        }
+
+        Game game(puzzle);
+        std::uint64_t moveNanos = 0, undoNanos = 0, redoNanos = 0;
+        for (int round = 0; round < rounds; ++round) {
+            Clock::time_point start = Clock::now();
+            for (int index : emptyCells) {
+                game.makeMove(index / Grid::GRID_SIZE, index % Grid::GRID_SIZE, solution.cellValue(index));
+            }
+            moveNanos += elapsedNanos(start);
+
+            start = Clock::now();
+            for (std::size_t i = 0; i < emptyCells.size(); ++i) {
+                game.undo();
+            }
+            undoNanos += elapsedNanos(start);
+
+            start = Clock::now();
+            for (std::size_t i = 0; i < emptyCells.size(); ++i) {
+                game.redo();
+            }
+            redoNanos += elapsedNanos(start);
+
+            if (!game.isSolved()) {
+                std::cerr << "  game round did not end solved\n";
+            }
+            game.reset();
+        }
+
+        const double operations = static_cast<double>(rounds) * emptyCells.size();
+        metrics["game.make_move.mean_ns"] = moveNanos / operations;
+        metrics["game.undo.mean_ns"] = undoNanos / operations;
+        metrics["game.redo.mean_ns"] = redoNanos / operations;
+
+        // a player who only follows hints: ask, play what the hint says, repeat until solved
+        std::uint64_t hintNanos = 0, hints = 0;
+        for (int round = 0; round < rounds / 10; ++round) {
+            Game walk(puzzle);
+            while (!walk.isSolved()) {
+                const Clock::time_point start = Clock::now();
+                const Hint hint = walk.nextHint();
+                hintNanos += elapsedNanos(start);
+                ++hints;
+                if (hint.kind == Hint::Kind::NONE) {
+                    std::cerr << "  hint walk got stuck\n";
+                    break;
+                }
+                if (hint.kind != Hint::Kind::ELIMINATE) {
+                    walk.makeMove(hint.row, hint.col, hint.digit);
+                }
+            }
+        }
+        metrics["game.hint.mean_ns"] = static_cast<double>(hintNanos) / hints;
+    }
+
+    // true if `digit` is the only candidate of `index`, or `index` is the only cell of one of its units
+    // that still allows `digit`
+    bool placementJustified(const Grid& position, int index, int digit) {
+        const Grid::Mask bit = Grid::digitMask(digit);
+        if (position.cellCandidates(index) == bit) {
+            return true;
+        }
+        const int row = index / Grid::GRID_SIZE;
+        const int col = index % Grid::GRID_SIZE;
+        for (const int unit : {row, Grid::GRID_SIZE + col, 2 * Grid::GRID_SIZE + Grid::getBoxIndex(row, col)}) {
+            int holders = 0;
+            for (const auto cell : Grid::unitCells(unit)) {
+                holders += position.cellValue(cell) == Grid::EMPTY && (position.cellCandidates(cell) & bit);
+            }
+            if (holders == 1 && (position.cellCandidates(index) & bit)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // follows the hints through the hard, expert and curated puzzles on a copy of the position that takes
+    // the same moves and eliminations. Every PLACE hint must be a naked or hidden single there and every
+    // ELIMINATE hint must remove live candidates, otherwise it counts as unjustified and the run fails
+    void checkHints(const std::vector<Corpus>& corpora, Metrics& metrics) {
+        int unjustified = 0;
+        for (const Corpus& corpus : corpora) {
+            if (corpus.name != "hard" && corpus.name != "expert" && corpus.name != "curated") {
+                continue;
+            }
+            for (std::size_t i = 0; i < corpus.puzzles.size() && i < 100; ++i) {
+                Game walk(corpus.puzzles[i]);
+                Grid position = corpus.puzzles[i];
+                while (!walk.isSolved()) {
+                    const Hint hint = walk.nextHint();
+                    const int index = hint.row * Grid::GRID_SIZE + hint.col;
+                    if (hint.kind == Hint::Kind::ELIMINATE) {
+                        const Grid::Mask cand = position.cellCandidates(index);
+                        unjustified += hint.eliminated == 0 || (hint.eliminated & ~cand) != 0;
+                        position.setCandidateMask(hint.row, hint.col, cand & ~hint.eliminated);
+                        continue;
+                    }
+                    if (hint.kind != Hint::Kind::PLACE && hint.kind != Hint::Kind::SOLUTION) {
+                        std::cerr << "  hint check got stuck on " << corpus.name << " puzzle " << i << "\n";
+                        ++unjustified;
+                        break;
+                    }
+                    if (hint.kind == Hint::Kind::PLACE && !placementJustified(position, index, hint.digit)) {
+                        std::cerr << "  " << SolverStats::TECHNIQUE_NAMES[hint.technique] << " hint " << hint.digit
+                                  << " at r" << hint.row + 1 << "c" << hint.col + 1 << " of " << corpus.name
+                                  << " puzzle " << i << " is not justified\n";
+                        ++unjustified;
+                    }
+                    walk.makeMove(hint.row, hint.col, hint.digit);
+                    position.set(hint.row, hint.col, hint.digit);
+                }
+            }
+        }
+        metrics["game.hint.unjustified"] = unjustified;
+    }
+
+    // many sessions of one puzzle, each thread plays moves and undos on randomly picked sessions.
+    // all_threads runs one thread per hardware thread, so it only scales on a multi-core machine
+    void benchStore(const Options& options, Metrics& metrics) {
+        const int sessions = options.quick ? 10000 : 100000;
+        const int opsPerThread = options.quick ? 100000 : 1000000;
+        Generator generator(seedFor(Generator::Difficulty::MEDIUM) + 3);
+        Grid solution;
+        const Grid puzzle = generator.generate(Generator::Difficulty::MEDIUM, solution);
+
+        GameStore store(sessions);
+        std::vector<GameStore::Handle> handles;
+        handles.reserve(sessions);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < sessions; ++i) {
+            handles.push_back(store.create(puzzle));
+        }
+        metrics["store.create.mean_ns"] = elapsedNanos(start) / static_cast<double>(sessions);
+        metrics["store.bytes_per_session"] = static_cast<double>(GameStore::bytesPerSession());
+
+        auto play = [&](unsigned threads) {
+            std::vector<std::thread> workers;
+            const Clock::time_point begin = Clock::now();
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    std::uint32_t state = 2463534242u + t; // xorshift, cheap enough not to dominate
+                    for (int op = 0; op < opsPerThread; ++op) {
+                        state ^= state << 13;
+                        state ^= state >> 17;
+                        state ^= state << 5;
+                        const GameStore::Handle handle = handles[state % handles.size()];
+                        const int index = static_cast<int>((state >> 8) % Grid::CELL_COUNT);
+                        if (op % 4 == 3) {
+                            store.undo(handle);
+                        }
+                        else {
+                            store.makeMove(handle, index / Grid::GRID_SIZE, index % Grid::GRID_SIZE, solution.cellValue(index));
+                        }
+                    }
+                });
+            }
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+            return static_cast<double>(threads) * opsPerThread / std::chrono::duration<double>(Clock::now() - begin).count();
+        };
+        metrics["store.one_thread.ops_per_sec"] = play(1);
+        metrics["store.all_threads.ops_per_sec"] = play(std::max(1u, std::thread::hardware_concurrency()));
+
+        // one sweep to clear the use bits, the second evicts everything
+        store.sweep();
+        start = Clock::now();
+        const std::size_t evicted = store.sweep();
+        metrics["store.sweep_us"] = elapsedNanos(start) / 1000.0;
+        if (evicted != static_cast<std::size_t>(sessions)) {
+            std::cerr << "  sweep evicted " << evicted << " of " << sessions << " sessions\n";
+        }
+    }
+
+    // the corpora repeated into a text file, packed without rating, then read back by random id
+    void benchDatabase(const Options& options, const std::vector<Corpus>& corpora, Metrics& metrics) {
+        const std::size_t puzzles = options.quick ? 100000 : 1000000;
+        const std::filesystem::path directory = std::filesystem::temp_directory_path();
+        const std::string stem = "sudoku-bench-" + std::to_string(::getpid());
+        const std::string textPath = (directory / (stem + ".txt")).string();
+        const std::string databasePath = (directory / (stem + ".db")).string();
+
+        std::vector<std::string> lines;
+        for (const Corpus& corpus : corpora) {
+            for (const Grid& puzzle : corpus.puzzles) {
+                std::string line;
+                for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+                    line += static_cast<char>('0' + puzzle.cellValue(index));
+                }
+                lines.push_back(line + '\n');
+            }
+        }
+        {
+            std::ofstream text(textPath, std::ios::binary);
+            for (std::size_t i = 0; i < puzzles; ++i) {
+                text << lines[i % lines.size()];
+            }
+        }
+
+        try {
+            PuzzleDatabase::PackOptions packOptions;
+            packOptions.rate = false;
+            const PuzzleDatabase::PackSummary summary = PuzzleDatabase::pack(textPath, databasePath, packOptions);
+            metrics["db.pack.puzzles_per_sec"] = summary.seconds > 0 ? summary.puzzles / summary.seconds : 0.0;
+
+            const PuzzleDatabase database(databasePath);
+            metrics["db.bytes_per_puzzle"] = static_cast<double>(std::filesystem::file_size(databasePath)) / database.size();
+
+            const int reads = options.quick ? 1000000 : 10000000;
+            std::uint8_t cells[Grid::CELL_COUNT];
+            std::uint64_t checksum = 0;
+            std::uint32_t state = 2463534242u;
+            const Clock::time_point start = Clock::now();
+            for (int i = 0; i < reads; ++i) {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                database.cells(state % database.size(), cells);
+                checksum += cells[i % Grid::CELL_COUNT];
+            }
+            metrics["db.random_read.mean_ns"] = elapsedNanos(start) / static_cast<double>(reads);
+            if (checksum == 0) {
+                std::cerr << "  database reads came back empty\n";
+            }
+        }
+        catch (...) {
+            std::filesystem::remove(textPath);
+            std::filesystem::remove(databasePath);
+            throw;
+        }
+        std::filesystem::remove(textPath);
+        std::filesystem::remove(databasePath);
+    }
+
+    // canonical forms of every corpus puzzle, then index inserts of distinct hashes
+    void benchDedup(const Options& options, const std::vector<Corpus>& corpora, Metrics& metrics) {
+        std::uint8_t canonical[Grid::CELL_COUNT];
+        std::uint64_t checksum = 0;
+        std::size_t forms = 0;
+        Clock::time_point start = Clock::now();
+        for (const Corpus& corpus : corpora) {
+            for (const Grid& puzzle : corpus.puzzles) {
+                Canonical::form(puzzle, canonical);
+                checksum += canonical[Grid::CELL_COUNT - 1];
+                ++forms;
+            }
+        }
+        metrics["canonical.form.mean_us"] = elapsedNanos(start) / 1000.0 / forms;
+        if (checksum == 0) {
+            std::cerr << "  canonical forms came back empty\n";
+        }
+
+        const std::uint64_t inserts = options.quick ? 1000000 : 10000000;
+        DedupIndex index;
+        start = Clock::now();
+        for (std::uint64_t i = 1; i <= inserts; ++i) {
+            index.insert({i * 0x9E3779B97F4A7C15ull, i * 0xC2B2AE3D27D4EB4Full});
+        }
+        metrics["dedup.insert.mean_ns"] = elapsedNanos(start) / static_cast<double>(inserts);
+    }
+
+    // every corpus puzzle solved through the cache twice: the first pass fills it, the second is all hits
+    // (the first has some too, the corpora repeat a few puzzles)
+    void benchCache(const std::vector<Corpus>& corpora, Metrics& metrics) {
+        SolutionCache cache;
+        std::size_t solves = 0;
+        double passNanos[2] = {0, 0};
+        for (int pass = 0; pass < 2; ++pass) {
+            const Clock::time_point start = Clock::now();
+            for (const Corpus& corpus : corpora) {
+                for (const Grid& puzzle : corpus.puzzles) {
+                    Grid grid = puzzle;
+                    if (!cache.solve(grid, Solver::Strategy::BITBOARD)) {
+                        std::cerr << "  cached solve failed\n";
+                    }
+                    solves += pass == 0;
+                }
+            }
+            passNanos[pass] = elapsedNanos(start);
+        }
+        metrics["cache.miss.mean_us"] = passNanos[0] / 1000.0 / solves;
+        metrics["cache.hit.mean_ns"] = passNanos[1] / solves;
+    }
+
+    // 81 character lines of the corpus puzzles through Grid::parseCells
+    void benchParse(const Options& options, const std::vector<Corpus>& corpora, Metrics& metrics) {
+        std::vector<std::string> lines;
+        for (const Corpus& corpus : corpora) {
+            for (const Grid& puzzle : corpus.puzzles) {
+                std::string line(Grid::CELL_COUNT, '.');
+                for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+                    if (puzzle.cellValue(index) != Grid::EMPTY) {
+                        line[index] = static_cast<char>('0' + puzzle.cellValue(index));
+                    }
+                }
+                lines.push_back(line);
+            }
+        }
+
+        const std::size_t parses = options.quick ? 1000000 : 10000000;
+        std::uint8_t cells[Grid::CELL_COUNT];
+        std::uint64_t checksum = 0;
+        const Clock::time_point start = Clock::now();
+        for (std::size_t i = 0; i < parses; ++i) {
+            if (Grid::parseCells(lines[i % lines.size()], cells)) {
+                checksum += cells[i % Grid::CELL_COUNT];
+            }
+        }
+        metrics["parse.line.mean_ns"] = elapsedNanos(start) / static_cast<double>(parses);
+        if (checksum == 0) {
+            std::cerr << "  parsed lines came back empty\n";
+        }
+    }
+
+    // the corpus puzzles, repeated, solved by two worker processes through the shared memory ring
+    void benchWorkers(const Options& options, const std::vector<Corpus>& corpora, Metrics& metrics) {
+        const std::string path = (std::filesystem::temp_directory_path() / ("sudoku-bench-" + std::to_string(::getpid()) + ".workers")).string();
+        {
+            std::ofstream text(path, std::ios::binary);
+            for (int repeat = 0; repeat < (options.quick ? 20 : 200); ++repeat) {
+                for (const Corpus& corpus : corpora) {
+                    for (const Grid& puzzle : corpus.puzzles) {
+                        for (int cell = 0; cell < Grid::CELL_COUNT; ++cell) {
+                            text << static_cast<char>('0' + puzzle.cellValue(cell));
+                        }
+                        text << '\n';
+                    }
+                }
+            }
+        }
+        const int devNull = ::open("/dev/null", O_WRONLY);
+        try {
+            ProcessBatch::Options workerOptions;
+            workerOptions.processes = 2;
+            const ProcessBatch::Summary summary = ProcessBatch::run(path, devNull, workerOptions);
+            metrics["workers.solve.puzzles_per_sec"] = summary.seconds > 0 ? summary.jobs / summary.seconds : 0.0;
+            metrics["workers.solve.failed"] = static_cast<double>(summary.failed);
+        }
+        catch (...) {
+            ::close(devNull);
+            std::filesystem::remove(path);
+            throw;
+        }
+        ::close(devNull);
+        std::filesystem::remove(path);
+    }
+
+    // the corpus puzzles through a daemon on a private socket: pipelined with 256 requests in
+    // flight, then one blocking call at a time for the round trip
+    void benchDaemon(const Options& options, const std::vector<Corpus>& corpora, Metrics& metrics) {
+        SolverDaemon::Options daemonOptions;
+        daemonOptions.socketPath = (std::filesystem::temp_directory_path() / ("sudoku-bench-" + std::to_string(::getpid()) + ".sock")).string();
+        daemonOptions.threads = 2;
+        SolverDaemon daemon(daemonOptions);
+        std::thread server([&] { daemon.run(); });
+
+        try {
+            std::vector<std::array<std::uint8_t, Grid::CELL_COUNT>> puzzles;
+            for (const Corpus& corpus : corpora) {
+                for (const Grid& puzzle : corpus.puzzles) {
+                    puzzles.push_back(puzzle.getCells());
+                }
+            }
+
+            SolverClient client(daemonOptions.socketPath);
+            const std::size_t requests = puzzles.size() * (options.quick ? 20 : 200);
+            std::size_t sent = 0;
+            std::size_t solved = 0;
+            SolverClient::Reply reply;
+            Clock::time_point start = Clock::now();
+            for (std::size_t received = 0; received < requests; ++received) {
+                for (; sent < requests && sent - received < 256; ++sent) {
+                    client.send(SolverProtocol::Type::Solve, static_cast<int>(Solver::Strategy::BITBOARD),
+                                puzzles[sent % puzzles.size()].data(), Grid::CELL_COUNT);
+                }
+                client.receive(reply);
+                solved += reply.status == SolverProtocol::Status::Ok;
+            }
+            metrics["daemon.pipelined.requests_per_sec"] = requests / (elapsedNanos(start) / 1e9);
+            metrics["daemon.pipelined.solved"] = static_cast<double>(solved);
+
+            LatencyHistogram latency;
+            start = Clock::now();
+            for (const auto& puzzle : puzzles) {
+                std::array<std::uint8_t, Grid::CELL_COUNT> cells = puzzle;
+                const Clock::time_point begin = Clock::now();
+                client.solve(cells.data());
+                latency.record(elapsedNanos(begin));
+            }
+            addLatency(metrics, "daemon.call", latency, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+        catch (...) {
+            daemon.stop();
+            server.join();
+            throw;
+        }
+        daemon.stop();
+        server.join();
+    }
+
+    // heap allocations made by the second of two identical passes, the first sizes the thread local scratch
+    template <typename Work>
+    std::uint64_t allocationsOf(Work work) {
+        work();
+        const std::uint64_t before = allocations.load();
+        work();
+        return allocations.load() - before;
+    }
+
+    // steady state allocations of the hot paths, every alloc.* metric is expected to be 0.
+    // A batch run has a fixed setup cost (threads, chunk list, buffers), so the metric is what
+    // the whole corpus allocates beyond a run that only fills the window
+    void benchAllocations(const std::vector<Corpus>& corpora, Metrics& metrics) {
+        for (Solver::Strategy strategy : STRATEGIES) {
+            metrics[std::string("alloc.solve.") + Solver::strategyName(strategy)] = static_cast<double>(allocationsOf([&] {
+                for (const Corpus& corpus : corpora) {
+                    for (const Grid& puzzle : corpus.puzzles) {
+                        Grid grid = puzzle;
+                        Solver::solve(grid, strategy);
+                    }
+                }
+            }));
+        }
+        metrics["alloc.unique"] = static_cast<double>(allocationsOf([&] {
+            for (const Corpus& corpus : corpora) {
+                for (const Grid& puzzle : corpus.puzzles) {
+                    Solver::hasUniqueSolution(puzzle);
+                }
+            }
+        }));
+
+        Generator generator(seedFor(Generator::Difficulty::EASY) + 5);
+        DedupIndex index(1 << 16);
+        generator.setDedupIndex(&index);
+        metrics["alloc.generate"] = static_cast<double>(allocationsOf([&] {
+            for (Generator::Difficulty difficulty : DIFFICULTIES) {
+                for (int i = 0; i < 5; ++i) {
+                    generator.generate(difficulty);
+                }
+            }
+        }));
+
+        // the whole corpus, and just enough of it to fill every slot of the window once
+        constexpr std::size_t LINES_PER_CHUNK = 8;
+        constexpr std::size_t CHUNKS_IN_FLIGHT = 4;
+        const std::string base = (std::filesystem::temp_directory_path() / ("sudoku-bench-" + std::to_string(::getpid()))).string();
+        const std::string path = base + ".batch";
+        const std::string setupPath = base + ".setup";
+        std::size_t lines = 0;
+        {
+            std::ofstream text(path, std::ios::binary);
+            std::ofstream setup(setupPath, std::ios::binary);
+            for (const Corpus& corpus : corpora) {
+                for (const Grid& puzzle : corpus.puzzles) {
+                    std::string line;
+                    for (int cell = 0; cell < Grid::CELL_COUNT; ++cell) {
+                        line.push_back(static_cast<char>('0' + puzzle.cellValue(cell)));
+                    }
+                    line.push_back('\n');
+                    text << line;
+                    if (lines++ < LINES_PER_CHUNK * CHUNKS_IN_FLIGHT) {
+                        setup << line;
+                    }
+                }
+            }
+        }
+        const int devNull = ::open("/dev/null", O_WRONLY);
+        try {
+            auto batch = [&](const std::string& input) {
+                BatchSolver::Options batchOptions;
+                batchOptions.threads = 2;
+                batchOptions.chunksInFlight = CHUNKS_IN_FLIGHT;
+                batchOptions.chunkBytes = LINES_PER_CHUNK * (Grid::CELL_COUNT + 1);
+                return allocationsOf([&] { BatchSolver::run(input, devNull, batchOptions); });
+            };
+            // a run's fixed cost (threads, chunk list, one buffer per slot) is what the setup
+            // input allocates. Every puzzle and chunk past it must come for free
+            const std::uint64_t setup = batch(setupPath);
+            const std::uint64_t full = batch(path);
+            metrics["alloc.batch"] = static_cast<double>(full > setup ? full - setup : 0);
+            std::cerr << "  batch of " << lines << " puzzles: " << full << " allocations, "
+                      << setup << " for the first " << LINES_PER_CHUNK * CHUNKS_IN_FLIGHT << "\n";
+        }
+        catch (...) {
+            ::close(devNull);
+            std::filesystem::remove(path);
+            std::filesystem::remove(setupPath);
+            throw;
+        }
+        ::close(devNull);
+        std::filesystem::remove(path);
+        std::filesystem::remove(setupPath);
+    }
+
+    void writeJson(std::ostream& out, const Options& options, const Metrics& metrics) {
+        out << "{\n"
+            << "  \"benchmark\": \"sudoku\",\n"
+            << "  \"quick\": " << (options.quick ? "true" : "false") << ",\n"
+            << "  \"band_kernel\": \"" << BandSolver::kernelName() << "\",\n"
+            << "  \"metrics\": {\n";
+        std::size_t written = 0;
+        for (const auto& [name, value] : metrics) {
+            out << "    \"" << name << "\": " << value << (++written < metrics.size() ? ",\n" : "\n");
+        }
+        out << "  }\n}\n";
+    }
+
+    // reads every "name": number pair, which is all a file written by writeJson holds besides the header
+    Metrics readBaseline(const char* path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error(std::string("Benchmark - Cannot open baseline ") + path);
+        }
+        const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        Metrics metrics;
+        for (std::size_t pos = text.find('"'); pos != std::string::npos; pos = text.find('"', pos)) {
+            const std::size_t close = text.find('"', pos + 1);
+            if (close == std::string::npos) {
+                break;
+            }
+            const std::string key = text.substr(pos + 1, close - pos - 1);
+            std::size_t next = text.find_first_not_of(" \t\r\n", close + 1);
+            pos = close + 1;
+            if (next == std::string::npos || text[next] != ':') {
+                continue;
+            }
+            const char* begin = text.c_str() + next + 1;
+            char* end = nullptr;
+            const double value = std::strtod(begin, &end);
+            if (end != begin) {
+                metrics[key] = value;
+                pos = static_cast<std::size_t>(end - text.c_str());
+            }
+        }
+        return metrics;
+    }
+
+    // rates must not drop and times must not grow by more than the tolerance, counts must match exactly.
+    // max latency is a single sample and too noisy to judge, it is reported only
+    int compareWithBaseline(const Metrics& current, const Metrics& baseline, double tolerance) {
+        auto endsWith = [](const std::string& text, const char* suffix) {
+            const std::size_t length = std::strlen(suffix);
+            return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+        };
+
+        int regressions = 0;
+        for (const auto& [name, value] : current) {
+            const auto found = baseline.find(name);
+            if (found == baseline.end() || endsWith(name, ".max_us")) {
+                continue;
+            }
+            const double before = found->second;
+            bool regressed;
+            if (endsWith(name, "_per_sec")) {
+                regressed = value < before * (1.0 - tolerance);
+            }
+            else if (endsWith(name, "_us") || endsWith(name, "_ns")) {
+                regressed = value > before * (1.0 + tolerance);
+            }
+            else {
+                regressed = value != before;
+            }
+
+            if (regressed) {
+                ++regressions;
+                const double change = before != 0 ? 100.0 * (value - before) / before : 0.0;
+                std::cerr << "REGRESSION " << name << ": " << before << " -> " << value
+                          << " (" << (change >= 0 ? "+" : "") << std::lround(change) << "%)\n";
+            }
+        }
+        std::cerr << regressions << " regression(s) against baseline, tolerance "
+                  << std::lround(tolerance * 100) << "%\n";
+        return regressions;
+    }
+
+    const char* optionValue(const char* arg, const char* name) {
+        const std::size_t length = std::strlen(name);
+        if (std::strncmp(arg, name, length) == 0 && arg[length] == '=') {
+            return arg + length + 1;
+        }
+        return nullptr;
+    }
+
+    void printUsage(const char* program) {
+        std::cerr << "usage: " << program << " [options]\n"
+                  << "  --quick             smaller corpora, for a fast sanity run\n"
+                  << "  --output=PATH       write JSON results to PATH instead of stdout\n"
+                  << "  --baseline=PATH     compare with an earlier JSON result, exit 1 on regressions\n"
+                  << "  --tolerance=F       allowed relative slowdown before flagging (default 0.10)\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        }
+        else if (const char* value = optionValue(argv[i], "--output")) {
+            options.outputPath = value;
+        }
+        else if (const char* value = optionValue(argv[i], "--baseline")) {
+            options.baselinePath = value;
+        }
+        else if (const char* value = optionValue(argv[i], "--tolerance")) {
+            options.tolerance = std::strtod(value, nullptr);
+        }
+        else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    try {
+        Metrics metrics;
+        std::cerr << "building corpora\n";
+        const std::vector<Corpus> corpora = buildCorpora(options);
+        std::cerr << "solvers\n";
+        benchSolvers(corpora, metrics);
+        std::cerr << "bounded solves\n";
+        benchBounded(corpora, metrics);
+        std::cerr << "generator\n";
+        benchGenerator(options, metrics);
+        std::cerr << "game\n";
+        benchGame(options, metrics);
+        checkHints(corpora, metrics);
+        std::cerr << "store\n";
+        benchStore(options, metrics);
+        std::cerr << "database\n";
+        benchDatabase(options, corpora, metrics);
+        std::cerr << "dedup\n";
+        benchDedup(options, corpora, metrics);
+        std::cerr << "cache\n";
+        benchCache(corpora, metrics);
+        std::cerr << "parse\n";
+        benchParse(options, corpora, metrics);
+        std::cerr << "worker processes\n";
+        benchWorkers(options, corpora, metrics);
+        std::cerr << "daemon\n";
+        benchDaemon(options, corpora, metrics);
+        std::cerr << "allocations\n";
+        benchAllocations(corpora, metrics);
+
+        if (options.outputPath) {
+            std::ofstream out(options.outputPath);
+            if (!out) {
+                throw std::runtime_error(std::string("Benchmark - Cannot write ") + options.outputPath);
+            }
+            writeJson(out, options, metrics);
+        }
+        else {
+            writeJson(std::cout, options, metrics);
+        }
+
+        int allocating = 0;
+        for (const auto& [name, value] : metrics) {
+            if (name.compare(0, 6, "alloc.") == 0 && value != 0) {
+                std::cerr << "ALLOCATING " << name << ": " << value << " heap allocations\n";
+                ++allocating;
+            }
+        }
+
+        const bool unjustified = metrics["game.hint.unjustified"] != 0;
+        if (unjustified) {
+            std::cerr << "UNJUSTIFIED game.hint.unjustified: " << metrics["game.hint.unjustified"] << " hints\n";
+        }
+
+        if (options.baselinePath) {
+            return compareWithBaseline(metrics, readBaseline(options.baselinePath), options.tolerance) || allocating || unjustified ? 1 : 0;
+        }
+        return allocating || unjustified ? 1 : 0;
+    }
+    catch (const std::exception& error) {
+        std::cerr << "error: " << error.what() << "\n";
+        return 1;
+    }
+}
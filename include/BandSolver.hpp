@@ -0,0 +1,20 @@
+#pragma once
+#include "Grid.hpp"
+#include <cstdint>
+
+// Bit-parallel 9x9 solver. Every digit keeps an 81-bit board of the cells it may occupy,
+// stored as three 27-bit bands in one 128-bit register. Eliminations and naked single
+// detection run on whole boards, hidden singles are unit mask intersections, and guesses
+// push a copy of the compact state onto a fixed stack.
+// The kernel is built for AVX2, SSE4.1 and plain integers and picked at runtime.
+class BandSolver {
+public:
+    // counts solutions up to limit honoring the grid's candidate masks, first one written to solution
+    static int solve(const Grid& grid, int limit, Grid* solution = nullptr);
+
+    // raw form, 81 cells with 0 for empty, for callers that never build a Grid
+    static int solveCells(const std::uint8_t* cells, std::uint8_t* solution, int limit);
+
+    // name of the kernel selected for this CPU
+    static const char* kernelName();
+};
\ No newline at end of file
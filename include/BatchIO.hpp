@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// File handling shared by the batch front ends: they read puzzle files a line at a time through
+// MappedFile, often cut into chunks for a pool, and write their results to a descriptor.
+class BatchIO {
+public:
+    struct Chunk {
+        const char* begin;
+        const char* end;
+    };
+
+    // cuts [data, data + size) into pieces of at least chunkBytes that end on a line break,
+    // except the last, so every line lies in exactly one chunk
+    static std::vector<Chunk> split(const char* data, std::size_t size, std::size_t chunkBytes);
+
+    // the next non blank line at or after `next`, without its "\n" or "\r\n". Moves `next`
+    // past it, false once only blank lines remain before `end`
+    static bool nextLine(const char*& next, const char* end, std::string_view& line) {
+        while (next < end) {
+            const char* newline = static_cast<const char*>(std::memchr(next, '\n', end - next));
+            const char* lineEnd = newline ? newline : end;
+            std::size_t length = static_cast<std::size_t>(lineEnd - next);
+            if (length > 0 && next[length - 1] == '\r') {
+                --length;
+            }
+            const char* start = next;
+            next = lineEnd + 1;
+            if (length > 0) {
+                line = std::string_view(start, length);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // retries short writes and EINTR, throws std::runtime_error naming `owner` on failure.
+    // with nonzero flags the bytes go through send(), e.g. MSG_NOSIGNAL for a socket
+    static void writeAll(int fd, const void* data, std::size_t size, const char* owner, int flags = 0);
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include "Solver.hpp"
+#include "LatencyHistogram.hpp"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+// Solves a file of puzzles, one line of 81 cells each as Grid::parseCells reads them ('0' or '.' for empty).
+// The file is memory mapped and cut into chunks at line boundaries, worker threads solve
+// chunks into private buffers and the calling thread writes them out in input order.
+// Solved lines become the 81 digit solution, other lines are echoed with " unsolved" or " invalid".
+class BatchSolver {
+public:
+    struct Options {
+        Solver::Strategy strategy = Solver::Strategy::BITBOARD;
+        unsigned threads = 0;                  // 0 = one per hardware thread
+        std::size_t chunkBytes = 1 << 20;      // input bytes per work item
+        std::size_t chunksInFlight = 0;        // solved but unwritten chunks, 0 = 4 per thread
+    };
+
+    struct Summary {
+        std::size_t puzzles = 0;
+        std::size_t solved = 0;
+        std::size_t unsolved = 0;
+        std::size_t invalid = 0;
+        double seconds = 0;
+        LatencyHistogram latency;              // per puzzle solve time
+    };
+
+    // throws std::runtime_error when the input cannot be mapped or the output cannot be written
+    static Summary run(const std::string& inputPath, int outputFd, const Options& options);
+    static void printSummary(const Summary& summary, std::ostream& out);
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include "Grid.hpp"
+#include <cstdint>
+
+// Canonical form of a 9x9 puzzle under every transformation that keeps it a valid sudoku:
+// transpose, band and stack order, row order inside a band, column order inside a stack and
+// digit relabelling. Two puzzles are the same puzzle exactly when their canonical forms match.
+// The form is the lexicographically smallest image, read row by row with empty cells as 0 and
+// digits numbered in order of first appearance.
+class Canonical {
+public:
+    struct Hash {
+        std::uint64_t low;
+        std::uint64_t high;
+
+        bool operator==(const Hash& other) const { return low == other.low && high == other.high; }
+        bool operator!=(const Hash& other) const { return !(*this == other); }
+    };
+
+    // 81 cells in, 81 cells out, 0 for empty
+    static void form(const std::uint8_t* cells, std::uint8_t* canonical);
+    static void form(const Grid& grid, std::uint8_t* canonical);
+
+    // hash of the canonical form, `low` alone is the 64 bit hash
+    static Hash hash(const std::uint8_t* cells);
+    static Hash hash(const Grid& grid);
+    static Hash hashForm(const std::uint8_t* canonical); // for a form computed already
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include "Grid.hpp"
+#include <vector>
+
+// Knuth's Algorithm X over the 324 column exact cover matrix of a 9x9 sudoku
+// (cell, row-digit, column-digit, box-digit constraints, one matrix row per cell/digit pair).
+// The matrix is linked once and restored after every puzzle, so an instance can be reused.
+class DancingLinks {
+public:
+    static constexpr int COLUMN_COUNT = 4 * Grid::CELL_COUNT;
+    static constexpr int ROW_COUNT = Grid::CELL_COUNT * Grid::GRID_SIZE;
+
+    DancingLinks();
+
+    // counts solutions up to limit, the first one found (givens included) is written into solution when given
+    int solve(const Grid& grid, int limit, Grid* solution = nullptr);
+
+    // preallocated instance owned by the calling thread
+    static DancingLinks& forThisThread();
+
+private:
+    static constexpr int ROOT = 0;
+    static constexpr int NODES_PER_ROW = 4;
+    static constexpr int FIRST_ROW_NODE = COLUMN_COUNT + 1;
+
+    // node links, headers are 1..COLUMN_COUNT and row nodes follow
+    std::vector<int> left;
+    std::vector<int> right;
+    std::vector<int> up;
+    std::vector<int> down;
+    std::vector<int> column;
+    std::vector<int> size;
+
+    // per puzzle state
+    std::vector<int> hiddenRows;
+    std::vector<int> givenRows;
+    std::vector<char> covered;
+    std::vector<int> choices;
+    Grid* target;
+    int limit;
+    int found;
+
+    // helpers
+    void cover(int col);
+    void uncover(int col);
+    void hideRow(int row);
+    void unhideRow(int row);
+    bool selectRow(int row);
+    void deselectRow(int row);
+    void search(int depth);
+    void writeRow(int row);
+    void restore();
+
+    static int nodeOf(int row) { return FIRST_ROW_NODE + row * NODES_PER_ROW; }
+};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include "Canonical.hpp"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Set of canonical puzzle hashes shared by any number of threads. Hashes are spread over
+// SHARD_COUNT open addressing tables by their top bits, each behind its own lock, so
+// threads inserting at the same time rarely wait on each other.
+// Entries are the full 128 bit hash; two different puzzles colliding is not a practical concern
+class DedupIndex {
+public:
+    static constexpr int SHARD_BITS = 6;
+    static constexpr int SHARD_COUNT = 1 << SHARD_BITS;
+
+    struct Summary {
+        std::size_t puzzles = 0;
+        std::size_t duplicates = 0;
+        std::size_t skipped = 0;   // lines Grid::parseCells rejects
+        double seconds = 0;
+    };
+
+    explicit DedupIndex(std::size_t expected = 0); // presizes for `expected` puzzles
+
+    DedupIndex(const DedupIndex&) = delete;
+    DedupIndex& operator=(const DedupIndex&) = delete;
+
+    // true if the hash was not in the index yet
+    bool insert(const Canonical::Hash& hash);
+    bool contains(const Canonical::Hash& hash) const;
+    std::size_t size() const;
+
+    // copies the lines of a file of 81 character puzzles to outputFd, leaving out every puzzle
+    // equivalent to one seen before (in this file or earlier through the index).
+    // throws std::runtime_error when the input cannot be mapped or the output cannot be written
+    Summary filter(const std::string& inputPath, int outputFd, unsigned threads = 0);
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::vector<Canonical::Hash> slots;  // {0, 0} marks an empty slot
+        std::size_t used = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+
+    // helpers
+    static Canonical::Hash key(const Canonical::Hash& hash); // never {0, 0}
+    Shard& shardFor(const Canonical::Hash& key) const;
+    static std::size_t find(const Shard& shard, const Canonical::Hash& key); // slot holding key or the empty slot it would go to
+    static void grow(Shard& shard);
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+
+// xoshiro256** (Blackman and Vigna), seeded through splitmix64 so any 64 bit seed, 0 included,
+// starts from a well mixed state. A handful of cycles per number against mt19937's 5 KB state
+// refills. Meets UniformRandomBitGenerator, so std::shuffle and the distributions take it
+class FastRandom {
+public:
+    using result_type = std::uint64_t;
+
+    explicit FastRandom(std::uint64_t seed = 0) { reseed(seed); }
+
+    void reseed(std::uint64_t seed) {
+        for (std::uint64_t& word : state) {
+            seed += 0x9E3779B97F4A7C15ull;
+            std::uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const std::uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // uniform in [0, bound), bound > 0. Lemire's multiply and shift, rejecting the few
+    // products that would make low values more likely
+    std::uint32_t below(std::uint32_t bound) {
+        std::uint64_t product = ((*this)() >> 32) * bound;
+        if (static_cast<std::uint32_t>(product) < bound) {
+            const std::uint32_t threshold = static_cast<std::uint32_t>(-bound) % bound;
+            while (static_cast<std::uint32_t>(product) < threshold) {
+                product = ((*this)() >> 32) * bound;
+            }
+        }
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+private:
+    std::uint64_t state[4];
+
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
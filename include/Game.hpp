@@ -1,14 +1,42 @@
 #pragma once
 #include "Grid.hpp"
-#include <stack>
+#include "SolverStats.hpp"
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
 
+// One journal entry, 12 bytes. Candidate changes are XOR deltas, so the same entry
+// takes the grid forward (redo) and back (undo)
 struct Move {
-    int row;
-    int col;
-    int oldValue;
-    int newValue;
-    std::set<int> oldCandidates; 
-    std::set<int> newCandidates;
+    std::uint32_t peersNew;    // bit i set -> peersOf(index)[i] toggled the new digit's candidate
+    std::uint32_t peersOld;    // same for the old digit
+    Grid::Mask cellDelta;      // old ^ new candidate mask of the cell itself
+    std::uint8_t index;        // row * GRID_SIZE + col
+    std::uint8_t values;       // oldValue << 4 | newValue
+
+    int oldValue() const { return values >> 4; }
+    int newValue() const { return values & 0xF; }
+};
+
+static_assert(sizeof(Move) == 12, "Move must stay a few bytes");
+static_assert(Grid::PEER_COUNT <= 32 && Grid::GRID_SIZE < 16, "Move packing assumes a 9x9 board");
+
+// next step for the player, as returned by Game::nextHint
+struct Hint {
+    enum class Kind : std::uint8_t {
+        NONE,        // solved, or no solution to steer towards
+        MISTAKE,     // (row, col) holds a wrong value, `digit` is the right one
+        PLACE,       // `technique` shows `digit` goes at (row, col)
+        ELIMINATE,   // `technique` removes `eliminated` from the candidates of (row, col)
+        SOLUTION     // no technique applies, `digit` at (row, col) is taken from the solution
+    };
+
+    Kind kind = Kind::NONE;
+    int technique = -1;          // index into SolverStats::TECHNIQUE_NAMES, PLACE and ELIMINATE only
+    int row = -1;
+    int col = -1;
+    int digit = 0;               // for ELIMINATE the lowest eliminated digit
+    Grid::Mask eliminated = 0;
 };
 
 class Game {
@@ -21,16 +49,51 @@ public:
     void redo();
     void reset();
 
+    // once more than `limit` moves are kept the oldest are dropped, 0 = keep everything
+    void setHistoryLimit(std::size_t limit);
+    std::size_t historySize() const { return journal.size(); }
+
+    // session as bytes: grid, journal and undo position. load throws std::runtime_error
+    // on anything that is not a complete session written by save
+    void save(std::ostream& out) const;
+    static Game load(std::istream& in);
+
     // state checks
     bool isSolved() const;
     const Grid& getGrid() const;
 
+    // hints, see Game.cpp. Repeated calls on an unchanged position are answered from cache
+    Hint nextHint();
+
+    // journal primitives, also used by GameStore. play makes the move on `grid` and describes
+    // it in `move`, false (grid untouched) for a fixed cell or out of range input.
+    // replay takes a grid from before `move` to after it (forward) or back
+    static bool play(Grid& grid, int row, int col, int value, Move& move);
+    static void replay(Grid& grid, const Move& move, bool forward);
+
 private:
     // data
-    Grid grid;                     
-    std::stack<Move> undoStack;
-    std::stack<Move> redoStack; 
+    Grid grid;
+    std::deque<Move> journal;   // [0, cursor) can be undone, [cursor, size) redone
+    std::size_t cursor;
+    std::size_t historyLimit;
+
+    // hint analysis: the grid plus every elimination handed out as a hint, kept in step with moves
+    // once the first hint is asked for
+    enum class SolutionState : std::uint8_t { Unknown, Unique, Missing };
+    bool analysing;
+    Grid analysis;
+    Grid solution;
+    SolutionState solutionState;
+    Grid::UnitSet pending[SolverStats::TECHNIQUE_COUNT]; // units each technique has not yet searched
+    Hint cachedHint;
+    bool hintValid;
 
     // helpers
+    void record(const Move& move);
+    void follow(const Move& move, bool forward);
+    Hint analyze();
+    void restartAnalysis();
+    bool knowSolution();
     void clearHistory();
-};
\ No newline at end of file
+};
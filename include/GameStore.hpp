@@ -0,0 +1,78 @@
+#pragma once
+#include "Game.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Many Game sessions in fixed size records, carved out of slabs that never move or shrink.
+// A session is addressed by a handle holding its slot and the slot's generation, so a handle
+// to a destroyed or evicted session is simply refused. Moves lock only their own record,
+// threads playing different sessions never touch a shared lock
+class GameStore {
+public:
+    using Handle = std::uint64_t;
+    static constexpr Handle INVALID_HANDLE = 0;     // never returned by create
+    static constexpr int HISTORY_LIMIT = 32;        // moves kept per session for undo and redo
+
+    explicit GameStore(std::size_t maxSessions = 1u << 20);
+    ~GameStore();
+
+    GameStore(const GameStore&) = delete;
+    GameStore& operator=(const GameStore&) = delete;
+
+    // throws std::length_error once maxSessions sessions are live
+    Handle create(const Grid& puzzle);
+    bool destroy(Handle handle);  // false for an unknown handle
+
+    // player actions, false for an unknown handle, a rejected move (see Game)
+    // or nothing left to undo or redo
+    bool makeMove(Handle handle, int row, int col, int value);
+    bool undo(Handle handle);
+    bool redo(Handle handle);
+
+    // state checks, false for an unknown handle
+    bool isSolved(Handle handle) const;
+    bool snapshot(Handle handle, Grid& grid) const;
+
+    // evicts every session not used since the previous sweep, returns how many went.
+    // calling it every N seconds drops sessions idle for N to 2N seconds
+    std::size_t sweep();
+
+    std::size_t size() const { return live.load(std::memory_order_relaxed); }
+    static std::size_t bytesPerSession();
+
+private:
+    static constexpr int SLAB_SHIFT = 10;
+    static constexpr std::uint32_t SLAB_SIZE = 1u << SLAB_SHIFT; // records per slab
+    static constexpr std::uint32_t MAX_CAPACITY = UINT32_MAX & ~(SLAB_SIZE - 1);   // whole slabs, slot numbers fit 32 bits
+
+    struct Record;
+
+    // test and test-and-set, one byte per record
+    class SpinLock {
+    public:
+        void lock();
+        void unlock() { locked.store(false, std::memory_order_release); }
+        bool tryLock() { return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire); }
+    private:
+        std::atomic<bool> locked{false};
+    };
+
+    // data
+    const std::uint32_t capacity;
+    const std::size_t slabCount;
+    std::unique_ptr<std::atomic<Record*>[]> slabs;  // slab i holds slots [i * SLAB_SIZE, (i + 1) * SLAB_SIZE)
+    std::atomic<std::uint32_t> slotCount;           // slots handed out so far, free or not
+    std::atomic<std::size_t> live;
+    std::mutex allocMutex;                          // guards freeSlots and slab creation
+    std::vector<std::uint32_t> freeSlots;
+
+    // helpers
+    Record* find(Handle handle) const;  // record for the handle's slot, nullptr if out of range
+    template <typename Action>
+    bool withSession(Handle handle, Action&& action) const;
+    void release(std::uint32_t slot);
+};
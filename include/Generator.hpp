@@ -1,28 +1,61 @@
 #pragma once
 #include "Grid.hpp"
 #include "Solver.hpp"
-#include <random>
+#include "FastRandom.hpp"
+#include "GridFactory.hpp"
+#include <cstdint>
 
-class Generator {
+class DedupIndex;
+
+// value = starting square amount on a 9x9 board, scaled by cell count on larger ones
+enum class GeneratorDifficulty {
+    EASY = 35,    
+    MEDIUM = 30,   
+    HARD = 25,     
+    EXPERT = 20    
+};
+
+// Puzzle generator for BasicGrid<BoxSize>, Generator makes 9x9 puzzles.
+// Definitions live in Generator.cpp, instantiated for box sizes 3, 4 and 5
+template <int BoxSize>
+class BasicGenerator {
 public:
-    // value = starting square amount
-    enum class Difficulty {
-        EASY = 35,    
-        MEDIUM = 30,   
-        HARD = 25,     
-        EXPERT = 20    
-    };
+    using Difficulty = GeneratorDifficulty;
+    using Grid = BasicGrid<BoxSize>;
+    using Solver = BasicSolver<BoxSize>;
 
-    Generator();
+    BasicGenerator();                             // seeded from std::random_device
+    explicit BasicGenerator(std::uint64_t seed);  // same seed, same puzzles
 
     Grid generate(Difficulty diff = Difficulty::EASY);
+    Grid generate(Difficulty diff, Grid& solution); // also hands back the completed grid
+
+    // clues removed per uniqueness check, a failed group falls back to one clue at a time
+    void setRemovalBatchSize(int size) { removalBatchSize = size > 0 ? size : 1; }
+
+    // search nodes a uniqueness check may spend before the clue is kept anyway, 0 = no limit.
+    // proving uniqueness gets expensive fast on sparse 16x16 and 25x25 boards
+    static constexpr std::uint64_t DEFAULT_NODE_BUDGET = BoxSize == 3 ? 0 : 1000;
+    void setNodeBudget(std::uint64_t nodes) { nodeBudget = nodes; }
+
+    // with an index set (9x9 only), generate skips puzzles equivalent to one already in the
+    // index and records what it returns. The index may be shared by generators on other threads.
+    // throws std::runtime_error after MAX_DUPLICATES duplicates in a row
+    static constexpr int MAX_DUPLICATES = 100;
+    void setDedupIndex(DedupIndex* index);
 
 private:
-    std::mt19937 rng; 
+    FastRandom rng;
+    BasicGridFactory<BoxSize> solutions;
+    int removalBatchSize;
+    std::uint64_t nodeBudget;
+    DedupIndex* dedup;
 
     // helpers
-    void fillDiagonal(Grid& grid);
-    bool fillRemaining(Grid& grid, int row, int col);
-    void removeNumbers(Grid& grid, Difficulty difficulty);
+    Grid generateOnce(Difficulty difficulty, Grid& solution);
+    void removeNumbers(Grid& grid, const Grid& solution, Difficulty difficulty);
+    bool removeGroup(Grid& grid, const Grid& solution, const int* cells, int count);
     int countFilledCells(const Grid& grid) const;
-};
\ No newline at end of file
+};
+
+using Generator = BasicGenerator<3>;
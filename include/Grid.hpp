@@ -3,38 +3,172 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <array>
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
 
-enum class CellState { Editable, Fixed };
+enum class CellState : std::uint8_t { Editable, Fixed };
+
+enum class ParseStatus : std::uint8_t { Ok, BadCharacter, TooFewCells, TooManyCells };
+
+// outcome of BasicGrid::parse, reported without building strings or throwing
+struct ParseResult {
+    ParseStatus status;
+    std::size_t offset;   // byte of the offending character, the end of the text otherwise
+    int cells;            // cells read before stopping
+    explicit operator bool() const { return status == ParseStatus::Ok; }
+};
+
+const char* parseStatusName(ParseStatus status);
+
+// smallest unsigned type holding `Bits` bits (up to 128)
+template <int Bits>
+using UnsignedBits = std::conditional_t<(Bits <= 8), std::uint8_t,
+                     std::conditional_t<(Bits <= 16), std::uint16_t,
+                     std::conditional_t<(Bits <= 32), std::uint32_t,
+                     std::conditional_t<(Bits <= 64), std::uint64_t, unsigned __int128>>>>;
+
+// Board of (BoxSize^2) x (BoxSize^2) cells, Grid is the classic 9x9 board.
+// Definitions live in Grid.cpp, instantiated for box sizes 3, 4 and 5.
+// Digits above 9 are written 'A' = 10, 'B' = 11, ... in text input and output.
+template <int BoxSize>
+class BasicGrid {
+    static_assert(BoxSize >= 2 && BoxSize <= 8, "BasicGrid - digits must fit a 64 bit mask");
 
-class Grid {
     public:
-        static constexpr int GRID_SIZE = 9; // size for whole sudoku board
-        static constexpr int SUBGRID_SIZE = 3; // size for a subgrid
+        static constexpr int GRID_SIZE = BoxSize * BoxSize; // size for whole sudoku board
+        static constexpr int SUBGRID_SIZE = BoxSize; // size for a subgrid
+        static constexpr int CELL_COUNT = GRID_SIZE * GRID_SIZE;
+        static constexpr int UNIT_COUNT = 3 * GRID_SIZE; // rows, then columns, then boxes
+        static constexpr int PEER_COUNT = 3 * (GRID_SIZE - 1) - 2 * (SUBGRID_SIZE - 1); // cells sharing a unit
         static constexpr int EMPTY = 0; // if cell == 0 -> empty
+
+        using Mask = UnsignedBits<GRID_SIZE>;  // bit (digit - 1) set -> digit is a candidate
+        using UnitSet = UnsignedBits<UNIT_COUNT>; // bit u set -> unit u (rows, then columns, then boxes)
+        using Index = UnsignedBits<(CELL_COUNT <= 256 ? 8 : 16)>; // cell index in the lookup tables
+
+        // shifted in two steps so a mask exactly as wide as its type does not shift by the full width
+        static constexpr Mask ALL_MASK = static_cast<Mask>((Mask(1) << (GRID_SIZE - 1) << 1) - 1); // every digit allowed
+        static constexpr UnitSet ALL_UNITS = static_cast<UnitSet>((UnitSet(1) << (UNIT_COUNT - 1) << 1) - 1);
         static const std::set<int> ALL_CANDIDATES;  // pencil marks
 
-        Grid();
+        // undo log for search, rollback(trail, mark) restores the grid to trail.checkpoint() == mark
+        class Trail {
+            public:
+                std::size_t checkpoint() const { return entries.size(); }
+                void reserve(std::size_t capacity) { entries.reserve(capacity); }
+                void clear() { entries.clear(); }
+            private:
+                friend class BasicGrid;
+                using Slot = UnsignedBits<(CELL_COUNT + UNIT_COUNT <= 256 ? 8 : 16)>;
+                struct Entry {
+                    Slot slot; // cell index, or CELL_COUNT + unit for occupancy masks
+                    std::uint8_t value;
+                    Mask mask;
+                };
+                std::vector<Entry> entries;
+        };
 
-        // core functionality 
+        BasicGrid();
+
+        // core functionality
         int get(int row, int col) const;
         void set(int row, int col, int val);
         CellState getCellState(int row, int col) const;
         void setCellState(int row, int col, CellState state);
-        const std::set<int>& getCandidates(int row, int col) const;
+        std::set<int> getCandidates(int row, int col) const;
         void updateAllCandidates();
         void updateCandidatesForCell(int row, int col);
         void setCandidates(int row, int col, const std::set<int>& newCandidates);
-        void clearCellCandidates(int row, int col); 
-        void clearCandidates(); 
+        void clearCellCandidates(int row, int col);
+        void clearCandidates();
         void toggleCandidate(int row, int col, int digit);
         void reset();
+        void completeWith(const std::uint8_t* values); // writes values into every empty editable cell, then recomputes all candidates
+        // completeWith for a solution known to be valid and to agree with the grid: every unit comes out
+        // full and every candidate set empty without recomputing them. Grids left with empty cells
+        // (empty fixed cells) fall back to completeWith's recomputation
+        void completeWithSolution(const std::uint8_t* solution);
+
+        // mask based candidate access
+        Mask getCandidateMask(int row, int col) const { return candidates[row * GRID_SIZE + col]; }
+        void setCandidateMask(int row, int col, Mask mask);
+        bool hasCandidate(int row, int col, int digit) const { return getCandidateMask(row, col) & digitMask(digit); }
+
+        // units whose values or candidates changed through the editing calls above since the last call.
+        // the search interface below does not record changes
+        UnitSet takeDirtyUnits() { const UnitSet units = dirtyUnits; dirtyUnits = 0; return units; }
+        int filledCount() const { return filled; }
+
+        // digits already placed in a unit
+        Mask getRowMask(int row) const { return rowUsed[row]; }
+        Mask getColumnMask(int col) const { return colUsed[col]; }
+        Mask getBoxMask(int box) const { return boxUsed[box]; }
+        Mask getUnitMask(int unit) const;
+
+        // search interface, cells addressed by index = row * GRID_SIZE + col, no bounds checks
+        int cellValue(int index) const { return cells[index]; }
+        Mask cellCandidates(int index) const { return candidates[index]; }
+        const std::array<std::uint8_t, CELL_COUNT>& getCells() const { return cells; }
+        const std::array<Mask, CELL_COUNT>& getCandidateMasks() const { return candidates; }
+        void place(int index, int digit, Trail& trail); // index must be empty
+        bool eliminate(int index, Mask mask, Trail& trail); // true if any candidate was removed
+        void rollback(Trail& trail, std::size_t mark);
+        static const std::array<Index, PEER_COUNT>& peersOf(int index);
+        static const std::array<Index, GRID_SIZE>& unitCells(int unit);
+
+        // mask helpers
+        static constexpr Mask digitMask(int digit) { return static_cast<Mask>(Mask(1) << (digit - 1)); }
+        static int countCandidates(Mask mask) {
+            if constexpr (sizeof(Mask) <= sizeof(unsigned)) {
+                return __builtin_popcount(mask);
+            }
+            else {
+                return __builtin_popcountll(mask);
+            }
+        }
+        static int lowestDigit(Mask mask) {
+            if constexpr (sizeof(Mask) <= sizeof(unsigned)) {
+                return __builtin_ctz(mask) + 1;
+            }
+            else {
+                return __builtin_ctzll(mask) + 1;
+            }
+        }
+        static int lowestUnit(UnitSet units) {
+            if constexpr (sizeof(UnitSet) <= sizeof(unsigned)) {
+                return __builtin_ctz(units);
+            }
+            else if constexpr (sizeof(UnitSet) <= sizeof(unsigned long long)) {
+                return __builtin_ctzll(units);
+            }
+            else {
+                const auto low = static_cast<unsigned long long>(units);
+                return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<unsigned long long>(units >> 64));
+            }
+        }
+        static constexpr int getBoxIndex(int row, int col) { return (row / SUBGRID_SIZE) * SUBGRID_SIZE + (col / SUBGRID_SIZE); }
+
+        // cell text: '1'..'9', then 'A' = 10, 'B' = 11, ...; '0' and '.' are empty
+        static int digitFromChar(char c); // -1 if c is not a digit of this board
+        static char charFromDigit(int digit);
 
         // reading input
         void loadFromStrings(const std::vector<std::string>& input);
+        void loadFromLine(const char* line, std::size_t length); // CELL_COUNT characters, '0' or '.' for empty
+        void loadFromCells(const std::uint8_t* values); // CELL_COUNT values, EMPTY or a digit
+
+        // Text in any of the accepted layouts: one line of CELL_COUNT cells, GRID_SIZE lines of
+        // GRID_SIZE cells, or a drawn grid where ' ', '|', '-' and '+' are separators and lines
+        // starting with '#' or '[' are comments (as in .sdk files). '0' and '.' are empty cells.
+        // parse leaves the grid untouched unless the result is Ok
+        ParseResult parse(std::string_view text);
+        static ParseResult parseCells(std::string_view text, std::uint8_t* values);
         static std::vector<std::string> readPuzzleFromConsole();
 
         // checkers
@@ -46,10 +180,25 @@ class Grid {
         void prettyPrintBoard() const;
     private:
         // data
-        std::array<std::array<int, GRID_SIZE>, GRID_SIZE> cells;
-        std::array<std::array<CellState, GRID_SIZE>, GRID_SIZE> cellStates;
-        std::array<std::array<std::set<int>, GRID_SIZE>, GRID_SIZE> candidates;
+        std::array<std::uint8_t, CELL_COUNT> cells;
+        std::array<CellState, CELL_COUNT> cellStates;
+        std::array<Mask, CELL_COUNT> candidates;
+        std::array<Mask, GRID_SIZE> rowUsed;
+        std::array<Mask, GRID_SIZE> colUsed;
+        std::array<Mask, GRID_SIZE> boxUsed;
+        std::uint16_t filled;   // non-empty cells
+        UnitSet dirtyUnits;
 
         // helpers
-        int getBoxIndex(int row, int col) const;
-};
\ No newline at end of file
+        void rebuildUsedMasks();
+        static int readLine(const char* line, std::uint8_t* values); // index of the first bad character, -1 if none
+        void placeDigit(int index, int digit);
+        void removeDigit(int index);
+        Mask usedMaskFor(int index) const;
+        void markDirty(int index);
+        Mask& unitMask(int slot);
+};
+
+using Grid = BasicGrid<3>;
+
+static_assert(std::is_trivially_copyable<Grid>::value, "Grid must stay cheap to copy");
@@ -0,0 +1,56 @@
+#pragma once
+#include "Grid.hpp"
+#include "FastRandom.hpp"
+#include <array>
+#include <cstdint>
+
+// Complete grids for BasicGrid<BoxSize>, GridFactory makes 9x9 ones. Definitions live in
+// GridFactory.cpp, instantiated for box sizes 3, 4 and 5.
+// A randomized search (fewest candidates first, digits in random order, restarted when it
+// wanders too long) makes a base grid. Every grid handed out is the base under a random
+// symmetry: digit relabeling, band and stack order, rows within bands, columns within stacks
+// and transposition, each uniform. Symmetries keep a grid valid and cost one pass over the
+// cells, so a base serves `transformsPerSearch` grids before the next search
+template <int BoxSize>
+class BasicGridFactory {
+public:
+    using Grid = BasicGrid<BoxSize>;
+    using Mask = typename Grid::Mask;
+
+    static constexpr int DEFAULT_TRANSFORMS_PER_SEARCH = 8;
+
+    BasicGridFactory();                           // seeded from std::random_device
+    explicit BasicGridFactory(std::uint64_t seed); // same seed, same grids
+
+    // every cell filled, every cell editable
+    Grid next();
+    // raw form, CELL_COUNT values, for callers that never build a Grid
+    void next(std::uint8_t* cells);
+
+    // 1 = a fresh search for every grid
+    void setTransformsPerSearch(int count) { transformsPerSearch = count > 0 ? count : 1; }
+
+private:
+    static constexpr std::uint64_t RESTART_NODES = 4 * Grid::CELL_COUNT;
+
+    FastRandom rng;
+    int transformsPerSearch;
+    int transformsLeft;
+
+    // search state
+    std::array<std::uint8_t, Grid::CELL_COUNT> base;
+    std::array<Mask, Grid::GRID_SIZE> rowUsed;
+    std::array<Mask, Grid::GRID_SIZE> colUsed;
+    std::array<Mask, Grid::GRID_SIZE> boxUsed;
+    std::array<typename Grid::Index, Grid::CELL_COUNT> empty; // the first emptyCount are the empty cells
+    int emptyCount;
+
+    // helpers
+    void search();
+    bool fill(std::uint64_t& nodesLeft);
+    void transform(std::uint8_t* cells);
+    void linePermutation(std::uint8_t* lines); // band (or stack) order, then the lines inside each
+    template <typename T> void shuffle(T* items, int count);
+};
+
+using GridFactory = BasicGridFactory<3>;
@@ -0,0 +1,32 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Log-linear histogram of durations in nanoseconds, 8 sub-buckets per power of two
+// (values are reported with at most 12.5% error). Histograms from several threads are merged.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(std::uint64_t nanos);
+    void merge(const LatencyHistogram& other);
+    void clear();
+
+    std::uint64_t count() const { return total; }
+    std::uint64_t max() const { return largest; }
+    double mean() const;
+    std::uint64_t percentile(double fraction) const; // fraction in [0, 1]
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::array<std::uint64_t, BUCKET_COUNT> buckets;
+    std::uint64_t total;
+    std::uint64_t largest;
+    long double sum;
+
+    static int bucketOf(std::uint64_t nanos);
+    static std::uint64_t upperBound(int bucket);
+};
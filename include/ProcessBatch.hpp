@@ -0,0 +1,44 @@
+#pragma once
+#include "Generator.hpp"
+#include "SharedRing.hpp"
+#include "Solver.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// BatchSolver's job with worker processes instead of threads, for fault isolation. The calling
+// process becomes the coordinator of a SharedRing, forks the workers and writes results in input
+// order. A worker that dies is replaced, and the jobs it held go to the other workers. A job that
+// takes down SharedRing::MAX_ATTEMPTS workers is reported as failed.
+// Input is one puzzle per line as Grid::parseCells reads them. Output lines:
+//   Solve     the 81 digit solution, or the line with " unsolved", " invalid" or " failed"
+//   Unique    the line with " unique", " not-unique", " no-solution", " invalid" or " failed"
+//   Generate  one 81 digit puzzle per line ('0' for empty), or "failed"
+class ProcessBatch {
+public:
+    struct Options {
+        SharedRing::Job job = SharedRing::Job::Solve;
+        Solver::Strategy strategy = Solver::Strategy::BITBOARD;
+        GeneratorDifficulty difficulty = GeneratorDifficulty::MEDIUM;
+        std::uint64_t seed = 1;                // puzzle i is generated from seed + i
+        unsigned processes = 0;                // 0 = one per hardware thread
+        std::size_t slots = 1024;              // ring capacity, jobs in flight
+    };
+
+    struct Summary {
+        std::size_t jobs = 0;
+        std::size_t invalid = 0;               // lines never submitted
+        std::size_t failed = 0;
+        std::size_t workerDeaths = 0;
+        std::size_t retried = 0;               // jobs taken back from dead workers
+        double seconds = 0;
+    };
+
+    // Solve and Unique. throws std::runtime_error when the input cannot be mapped, the ring cannot
+    // be created, a worker cannot be forked or the output cannot be written
+    static Summary run(const std::string& inputPath, int outputFd, const Options& options);
+    // Generate, `count` puzzles
+    static Summary generate(std::size_t count, int outputFd, const Options& options);
+    static void printSummary(const Summary& summary, std::ostream& out);
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include "Grid.hpp"
+#include "Generator.hpp"
+#include "MappedFile.hpp"
+#include "SolverStats.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Packed 9x9 puzzle library, read straight from a memory map.
+// Every puzzle is a fixed RECORD_BYTES record: the 81 cells as 27 groups of three cells
+// (a * 100 + b * 10 + c, 10 bits each) followed by its clue count and rating, so puzzle i
+// sits at a computed offset. Two indexes list the ids sorted by rating and by clue count,
+// each bucket a contiguous run, so a query hands back a range into the mapped file.
+// Layout (little endian): 64 byte header, records, rating index, clue index.
+class PuzzleDatabase {
+public:
+    using Id = std::uint32_t;
+
+    static constexpr int CELL_BYTES = 34;                 // 270 bits of cell groups
+    static constexpr int RECORD_BYTES = CELL_BYTES + 2;  // cells, clue count, rating
+
+    // rating: 1 + index in SolverStats::TECHNIQUE_NAMES of the hardest technique HUMAN needs
+    static constexpr int UNRATED = 0;                                     // packed without rating
+    static constexpr int NEEDS_SEARCH = SolverStats::TECHNIQUE_COUNT + 1; // techniques alone get stuck
+    static constexpr int NOT_UNIQUE = SolverStats::TECHNIQUE_COUNT + 2;   // no solution or several
+    static constexpr int RATING_COUNT = SolverStats::TECHNIQUE_COUNT + 3;
+
+    // ids pointing into the mapped index, valid while the database is open
+    class IdRange {
+    public:
+        IdRange(const Id* first, const Id* last) : first(first), last(last) {}
+        const Id* begin() const { return first; }
+        const Id* end() const { return last; }
+        std::size_t size() const { return static_cast<std::size_t>(last - first); }
+    private:
+        const Id* first;
+        const Id* last;
+    };
+
+    struct PackOptions {
+        unsigned threads = 0;              // 0 = one per hardware thread
+        bool rate = true;                  // false leaves every rating UNRATED
+        std::size_t chunkBytes = 1 << 20;  // input bytes per work item
+    };
+
+    struct PackSummary {
+        std::size_t puzzles = 0;
+        std::size_t skipped = 0;           // lines Grid::parseCells rejects
+        double seconds = 0;
+    };
+
+    // throws std::runtime_error when the file cannot be mapped or is not a complete database
+    explicit PuzzleDatabase(const std::string& path);
+
+    std::size_t size() const { return count; }
+
+    // record access, no bounds checks
+    void cells(std::size_t id, std::uint8_t* out) const { decode(record(id), out); } // 0 for empty
+    int clueCount(std::size_t id) const { return record(id)[CELL_BYTES]; }
+    int rating(std::size_t id) const { return record(id)[CELL_BYTES + 1]; }
+    Grid puzzle(std::size_t id) const; // throws std::out_of_range
+
+    // ids in ascending order within each bucket
+    IdRange withRating(int minRating, int maxRating) const;
+    IdRange withClues(int minClues, int maxClues) const;
+    IdRange withDifficulty(GeneratorDifficulty difficulty) const; // clue counts Generator aims for
+
+    // text with one 81 digit line per puzzle, '0' for empty. throws std::runtime_error on write errors
+    void writeText(int fd) const;
+    void writeText(int fd, IdRange ids) const;
+
+    // one 81 character line per puzzle in, database out. Blank lines are ignored
+    static PackSummary pack(const std::string& textPath, const std::string& databasePath, const PackOptions& options);
+
+    static int rate(const std::uint8_t* cells);
+    static void encode(const std::uint8_t* cells, std::uint8_t* out); // CELL_BYTES bytes
+    static void decode(const std::uint8_t* in, std::uint8_t* cells);
+
+private:
+    MappedFile file;
+    std::size_t count;
+    const std::uint8_t* records;
+    const std::uint64_t* ratingStarts;  // bucket r is ratingIds[ratingStarts[r], ratingStarts[r + 1])
+    const Id* ratingIds;
+    const std::uint64_t* clueStarts;
+    const Id* clueIds;
+
+    // helpers
+    const std::uint8_t* record(std::size_t id) const { return records + id * RECORD_BYTES; }
+};
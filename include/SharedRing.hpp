@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+// Ring of 9x9 jobs in POSIX shared memory, shared by one coordinator process and any number of
+// worker processes. A slot holds the job and the 81 cell bytes Grid keeps: the puzzle goes in,
+// the worker writes the solution (or the generated puzzle) over it in place.
+// Each slot has one atomic control word holding its state, the pid of the worker that claimed
+// it and how often it was claimed. Workers claim ready slots with a compare and swap, so there
+// is no lock. The coordinator submits and collects in sequence order, slot = sequence % slots.
+// When a worker dies, recover() puts the slots it held back up for claiming, and a slot whose
+// job has taken down MAX_ATTEMPTS workers comes back as Failed. No other slot is affected.
+// Two process shared semaphores wake sleeping workers and the coordinator. Waits time out, so a
+// lost wakeup costs a short delay and nothing else.
+class SharedRing {
+public:
+    enum class Job : std::uint8_t { Solve, Unique, Generate };
+    enum class Outcome : std::uint8_t { Pending, Solved, Unsolvable, Unique, NotUnique, Generated, Failed };
+
+    static constexpr int MAX_ATTEMPTS = 2;
+
+    struct Result {
+        std::uint64_t sequence;
+        Job job;
+        Outcome outcome;
+        const std::uint8_t* cells;  // in the ring, valid until the next submit
+    };
+
+    // made by the coordinator, replacing a stale segment of the same name. Workers are forked
+    // afterwards and inherit the mapping. The segment is unlinked when the coordinator's ring is
+    // destroyed. throws std::runtime_error when the segment cannot be created or mapped
+    SharedRing(const std::string& name, std::size_t slots);
+
+    SharedRing(const SharedRing&) = delete;
+    SharedRing& operator=(const SharedRing&) = delete;
+    ~SharedRing();
+
+    std::size_t slots() const;
+
+    // coordinator side, one thread. submit returns false while the slot for the next sequence
+    // still holds an uncollected job, collect returns false until the oldest job is done
+    bool submit(Job job, const std::uint8_t* cells, int option, std::uint64_t seed = 0); // option: strategy or difficulty
+    bool collect(Result& result);
+    std::size_t inFlight() const { return submitted - collected; }
+    void waitForResults(int timeoutMillis);
+    std::size_t recover(pid_t worker);      // slots `worker` held when it died, call after reaping it
+    void stop();                             // workers leave run() once nothing is ready
+
+    // worker side
+    bool serveOne();                         // claims and runs one ready job, false when there is none
+    void run();                              // serves until stop()
+
+private:
+    struct Header;
+    struct Slot;
+
+    std::string name;
+    pid_t creator;                           // forked workers share this object but must not unlink
+    Header* header;
+    Slot* slotArray;
+    std::size_t mappedBytes;
+    std::uint64_t submitted;
+    std::uint64_t collected;
+    std::size_t cursor;                      // where this worker looks for a ready slot first
+
+    // helpers
+    static void execute(Slot& slot);
+};
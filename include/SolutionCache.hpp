@@ -0,0 +1,59 @@
+#pragma once
+#include "Grid.hpp"
+#include "Solver.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Results of Solver::solve and Solver::hasUniqueSolution for 9x9 puzzles seen before.
+// Entries are keyed by the cell values in PuzzleDatabase's packed encoding and hold the
+// solution and the uniqueness verdict, each filled in by whichever call needed it first.
+// The memory budget is split into SHARD_COUNT shards, each behind its own lock, of buckets
+// with WAYS entries. A full bucket evicts CLOCK style: a hit sets an entry's referenced bit,
+// the hand clears bits until it finds an entry used less recently.
+// Calls the cache cannot answer exactly are passed straight to Solver and counted as bypassed:
+// HUMAN solves (which may fail where a search succeeds) and grids whose candidates are not
+// the ones their values imply, since the solvers honour hand edited candidates
+class SolutionCache {
+public:
+    static constexpr int SHARD_BITS = 6;
+    static constexpr int SHARD_COUNT = 1 << SHARD_BITS;
+    static constexpr int WAYS = 8;
+
+    struct Counters {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+        std::uint64_t bypassed = 0;
+    };
+
+    explicit SolutionCache(std::size_t maxBytes = 64 << 20);
+    ~SolutionCache();
+
+    SolutionCache(const SolutionCache&) = delete;
+    SolutionCache& operator=(const SolutionCache&) = delete;
+
+    // same contracts as the Solver functions. For a puzzle with several solutions solve
+    // hands back the one cached first
+    bool solve(Grid& grid, Solver::Strategy strategy);
+    bool hasUniqueSolution(const Grid& grid);
+
+    Counters counters() const;
+    std::size_t capacity() const; // entries
+    void clear();
+
+private:
+    struct Entry;
+    struct Bucket;
+    struct Shard;
+    struct Key;
+
+    std::unique_ptr<Shard[]> shards;
+    std::size_t bucketsPerShard;   // a power of two
+
+    // helpers
+    static bool standardCandidates(const Grid& grid);
+    Shard& shardFor(const Key& key) const;
+    Bucket& bucketFor(Shard& shard, const Key& key) const;
+};
@@ -1,36 +1,151 @@
 #pragma once
 #include "Grid.hpp"
+#include "SolverStats.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
 
-class Solver {
+enum class SolverStrategy {
+    BRUTE_FORCE,       
+    HUMAN,      
+    HYBRID,
+    DLX,               // exact cover search with dancing links
+    BITBOARD           // bit-parallel band kernel, see BandSolver
+};
+
+// how a bounded solve ended, see BasicSolver::solveWithin
+enum class SolveStatus {
+    SOLVED,              // exactly one solution
+    UNSOLVABLE,          // no solution
+    MULTIPLE_SOLUTIONS,  // more than one
+    OUT_OF_TIME,
+    OUT_OF_NODES,
+    CANCELLED
+};
+
+// Stop request shared by its copies: the caller keeps one, the solves it started get the others
+class CancellationToken {
 public:
-    enum class Strategy {
-        BRUTE_FORCE,       
-        HUMAN,      
-        HYBRID             
-    };
+    void cancel() { flag->store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+};
+
+// Solver for BasicGrid<BoxSize>, Solver is the 9x9 one. Definitions live in Solver.cpp,
+// instantiated for box sizes 3, 4 and 5. DLX and BITBOARD are 9x9 kernels, on larger
+// boards both run the MRV search that BRUTE_FORCE uses
+template <int BoxSize>
+class BasicSolver {
+public:
+    using Strategy = SolverStrategy;
+    using Grid = BasicGrid<BoxSize>;
+    using Mask = typename Grid::Mask;
+    using UnitSet = typename Grid::UnitSet;
+    using Trail = typename Grid::Trail;
+    using Index = typename Grid::Index;
+
+    static constexpr int MAX_SOLUTIONS_NEEDED = 2; // enough to tell unique from ambiguous
+
+    // lower case names used on the command line ("brute", "human", "hybrid", "dlx", "bitboard")
+    static const char* strategyName(Strategy strategy);
+    static bool parseStrategy(const std::string& name, Strategy& strategy);
+    static const char* statusName(SolveStatus status); // "solved", "unsolvable", "multiple", "timeout", "node-limit", "cancelled"
 
     // solve function
     static bool solve(Grid& grid, Strategy strategy);
-
-    // TODO: add solver with preprocessing to speed up brute force
+    static bool solve(Grid& grid, Strategy strategy, SolverStats& stats); // also fills stats
 
     // checkers (used in Solver and Generator)
     static bool hasUniqueSolution(const Grid& grid);
-    static int countSolutions(Grid& grid, int row = 0, int col = 0);
+    static int countSolutions(const Grid& grid, int limit = MAX_SOLUTIONS_NEEDED);
+    static int countSolutions(const Grid& grid, int limit, SolverStats& stats);
+    // gives up after `nodeBudget` search nodes (0 = never) and then answers `limit`, so a capped
+    // count errs only towards "not unique"
+    static int countSolutionsWithin(const Grid& grid, int limit, std::uint64_t nodeBudget);
+    static int countSolutionsUpTo(const Grid& grid, int limit, Strategy strategy = Strategy::DLX);
+
+    // one pass of human technique `technique` (SolverStats::TECHNIQUE_NAMES order) over `units`,
+    // true if it placed a digit or removed a candidate. throws std::out_of_range for a bad index
+    static bool applyTechnique(Grid& grid, int technique, UnitSet units);
+
+    // true if some solution puts a digit other than `digit` at (row, col). When grid has a known
+    // solution with `digit` there, this is exactly "grid has more than one solution".
+    // Also true once the search used up `nodeBudget` nodes (0 = no budget)
+    static bool hasSolutionWithout(const Grid& grid, int row, int col, int digit, std::uint64_t nodeBudget = 0);
+
+    // parallel enumeration on a work-stealing pool, subtrees are split off while workers are idle
+    struct CountOptions {
+        std::uint64_t limit = 0;                      // stop after this many solutions, 0 = count all
+        std::function<void(const Grid&)> onSolution;  // optional, once per solution, never concurrently
+        unsigned threads = 0;                         // 0 = one per hardware thread
+    };
+    static std::uint64_t countSolutionsParallel(const Grid& grid, const CountOptions& options);
+    static std::uint64_t countSolutionsParallel(const Grid& grid);
+
+    // Bounded solving for request paths. The search (the one BRUTE_FORCE uses, the DLX and
+    // bitboard kernels have no place to stop) checks the limits as it goes and gives up on
+    // the first one hit. It looks for a second solution, so the status also tells unique
+    // from ambiguous puzzles
+    struct Limits {
+        std::chrono::nanoseconds timeLimit{0};  // 0 = none. solveAsync counts from the call, time queued included
+        std::uint64_t nodeBudget = 0;           // search nodes, 0 = none
+        CancellationToken cancel;
+    };
+    struct BoundedResult {
+        SolveStatus status = SolveStatus::UNSOLVABLE;
+        Grid solution;                          // the first solution, when solutionsFound > 0
+        int solutionsFound = 0;                 // 1 with a stop status: solvable, uniqueness unknown
+        std::uint64_t nodes = 0;
+        int maxDepth = 0;
+        double seconds = 0;                     // in the search, not waiting for a worker
+    };
+    static BoundedResult solveWithin(const Grid& grid, const Limits& limits);
+    // same, on a pool shared by all callers with one worker per hardware thread
+    static std::future<BoundedResult> solveAsync(const Grid& grid, const Limits& limits);
 
 private:
     // helpers
+    // Stats is a hook policy (see Solver.cpp): the plain entry points pass one whose hooks are empty
+    template <typename Stats> static bool solveWith(Grid& grid, Strategy strategy, Stats& stats);
+    template <typename Stats> static int countWith(const Grid& grid, int limit, Stats& stats);
+
     // types of solves
-    static bool bruteForce(Grid& grid, int row, int col);
-    static bool nakedSingles(Grid& grid);
-    static bool hiddenSingles(Grid& grid);
-    static bool nakedPairs(Grid& grid);
+    template <typename Stats> static bool bruteForce(Grid& grid, Stats& stats);
+    template <typename Stats> static bool applyTechniques(Grid& grid, Stats& stats);
+
+    // human techniques, each looks only at `units` (or skips when none of them matter to it)
+    using Technique = bool (*)(Grid& grid, UnitSet units);
+    static constexpr int TECHNIQUE_COUNT = SolverStats::TECHNIQUE_COUNT;
+    static const Technique TECHNIQUES[TECHNIQUE_COUNT];
+    static bool nakedSingles(Grid& grid, UnitSet units);
+    static bool hiddenSingles(Grid& grid, UnitSet units);
+    static bool nakedPairs(Grid& grid, UnitSet units);
+    static bool pointingPairs(Grid& grid, UnitSet units);
+    static bool boxLineReduction(Grid& grid, UnitSet units);
+    static bool xWing(Grid& grid, UnitSet units);
+    static bool swordfish(Grid& grid, UnitSet units);
 
     // solve helpers
-    static bool findNakedPairsInRow(Grid& grid, int row);
-    static bool findNakedPairsInColumn(Grid& grid, int col);
-    static bool findNakedPairsInBox(Grid& grid, int startRow, int startCol);
+    static bool findNakedPairsInUnit(Grid& grid, int unit);
+    static bool findFish(Grid& grid, int size);
+    static bool removeCandidates(Grid& grid, int index, Mask mask);
+
+    // search: singles propagation at every node, branching on the cell with fewest candidates
+    template <typename Stats>
+    static int search(Grid& grid, Trail& trail, int limit, Grid* firstSolution, Stats& stats, int depth);
+    template <typename Stats>
+    static bool propagate(Grid& grid, Trail& trail, Stats& stats);
+    static int chooseBranchCell(const Grid& grid);
+
+    struct ParallelSearch;
+    static void searchParallel(Grid& grid, Trail& trail, ParallelSearch& shared, int depth);
+
+    static BoundedResult solveUntil(const Grid& grid, const Limits& limits, std::chrono::steady_clock::time_point deadline);
+};
 
-    // general helper
-    static bool canPlace(const Grid& grid, int row, int col, int num);
-};
\ No newline at end of file
+using Solver = BasicSolver<3>;
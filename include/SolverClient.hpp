@@ -0,0 +1,80 @@
+#pragma once
+#include "Generator.hpp"
+#include "LatencyHistogram.hpp"
+#include "Solver.hpp"
+#include "SolverProtocol.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Client side of SolverProtocol, for services calling SolverDaemon and for load testing it.
+// send() queues a request and returns its id, receive() writes out what is queued and waits for
+// the next reply. Any number of requests may be in flight on one connection. Replies come back
+// in the order the daemon finishes them and are matched by id.
+// The blocking calls (solve, unique, ...) send one request and wait for its reply, so they
+// must not be mixed with pipelined requests still in flight.
+class SolverClient {
+public:
+    struct Reply {
+        std::uint32_t id;
+        SolverProtocol::Type type;
+        SolverProtocol::Status status;
+        std::string payload;
+    };
+
+    // runFile and runGenerate keep `window` requests in flight and write one line per puzzle in
+    // input order, the formats of ProcessBatch plus " <rating>" for Rate, " bad-request" and " failed"
+    struct RunOptions {
+        SolverProtocol::Type type = SolverProtocol::Type::Solve;
+        Solver::Strategy strategy = Solver::Strategy::BITBOARD;
+        GeneratorDifficulty difficulty = GeneratorDifficulty::MEDIUM;
+        bool seeded = false;                   // generate: puzzle i from seed + i, else random
+        std::uint64_t seed = 1;
+        std::size_t window = 256;              // rounded up to a power of two
+    };
+
+    struct RunSummary {
+        std::size_t requests = 0;
+        std::size_t invalid = 0;               // lines never sent
+        std::size_t badRequests = 0;
+        std::size_t failed = 0;
+        double seconds = 0;
+        LatencyHistogram latency;              // send to reply, per request
+    };
+
+    // throws std::runtime_error when the daemon cannot be reached
+    explicit SolverClient(const std::string& socketPath);
+    ~SolverClient();
+
+    SolverClient(const SolverClient&) = delete;
+    SolverClient& operator=(const SolverClient&) = delete;
+
+    std::uint32_t send(SolverProtocol::Type type, int option, const void* payload, std::size_t length);
+    void flush();
+    // throws std::runtime_error when the daemon hangs up or breaks the protocol
+    void receive(Reply& reply);
+
+    // 81 cells in, 0 for empty. throw std::runtime_error when the daemon answers Failed
+    bool solve(std::uint8_t* cells, Solver::Strategy strategy = Solver::Strategy::BITBOARD); // solution over cells
+    SolverProtocol::Status unique(const std::uint8_t* cells);                                // Ok when unique
+    void generate(GeneratorDifficulty difficulty, std::uint8_t* cells);
+    void generate(GeneratorDifficulty difficulty, std::uint64_t seed, std::uint8_t* cells);
+    int rate(const std::uint8_t* cells);                                                     // PuzzleDatabase::rate
+    std::string stats();                                                                     // JSON
+
+    static RunSummary runFile(const std::string& socketPath, const std::string& inputPath, int outputFd, const RunOptions& options);
+    static RunSummary runGenerate(const std::string& socketPath, std::size_t count, int outputFd, const RunOptions& options);
+    static void printSummary(const RunSummary& summary, std::ostream& out);
+
+private:
+    int fd;
+    std::uint32_t nextId;
+    std::string outbox;
+    std::string inbox;
+    std::size_t inboxStart;
+    Reply reply;                               // for the blocking calls
+
+    // helpers
+    const Reply& call(SolverProtocol::Type type, int option, const void* payload, std::size_t length);
+};
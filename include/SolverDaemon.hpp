@@ -0,0 +1,97 @@
+#pragma once
+#include "LatencyHistogram.hpp"
+#include "SolverProtocol.hpp"
+#include "ThreadPool.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Long running 9x9 solver service on a Unix domain socket, speaking SolverProtocol.
+// One thread multiplexes the connections with poll(). It parses every complete request it has,
+// cuts what one round produced into batches of up to maxBatch, and hands each batch to a
+// ThreadPool as a single task. Requests that arrive together therefore share one hand off, and
+// the replies of a batch share one wakeup. A connection may have any number of requests in
+// flight. At most maxQueued requests are accepted and not yet answered. At that limit the daemon
+// stops reading, so the kernel's socket buffers fill and clients block in write. A connection
+// whose client does not read its replies is throttled the same way once maxUnsentBytes of them
+// wait to be written.
+// Latency histograms per request type run from a request being parsed to its reply being queued.
+class SolverDaemon {
+public:
+    struct Options {
+        std::string socketPath;
+        unsigned threads = 0;                  // pool threads, 0 = one per hardware thread
+        std::size_t maxQueued = 4096;
+        std::size_t maxBatch = 32;             // requests per pool task
+        std::size_t maxConnections = 1024;
+        std::size_t maxUnsentBytes = 256 << 10; // reply bytes per connection before it stops being read
+    };
+
+    struct Counters {
+        std::uint64_t connections = 0;         // accepted so far
+        std::uint64_t requests = 0;
+        std::uint64_t batches = 0;
+        std::uint64_t badRequests = 0;
+        std::uint64_t failed = 0;              // requests whose work threw
+        std::uint64_t pauses = 0;              // rounds that stopped reading at maxQueued
+        std::uint64_t throttles = 0;           // times a connection stopped being read at maxUnsentBytes
+    };
+
+    // binds and listens, replacing a stale socket file. throws std::runtime_error
+    explicit SolverDaemon(const Options& options);
+    ~SolverDaemon();
+
+    SolverDaemon(const SolverDaemon&) = delete;
+    SolverDaemon& operator=(const SolverDaemon&) = delete;
+
+    // serves until stop(), then answers nothing more and closes every connection
+    void run();
+    // from any thread or a signal handler
+    void stop();
+
+    Counters counters() const;
+    LatencyHistogram latency(SolverProtocol::Type type) const;
+    std::string statsJson() const;
+
+private:
+    struct Request;
+    struct Reply;
+    struct Connection;
+
+    Options options;
+    int listenFd;
+    int wakeFds[2];                            // pipe, written when replies are ready or on stop
+    std::atomic<bool> stopping;
+    std::atomic<std::size_t> queued;
+
+    // shared with the pool
+    mutable std::mutex completedMutex;
+    std::vector<Reply> completed;
+    std::array<LatencyHistogram, SolverProtocol::TYPE_COUNT> latencies;
+    Counters totals;
+
+    // run() thread only
+    std::unordered_map<std::uint64_t, std::unique_ptr<Connection>> connections;
+    std::uint64_t nextConnection;
+    std::vector<Reply> delivering;
+
+    ThreadPool pool;                           // last, so its tasks finish before the rest goes away
+
+    // helpers
+    void acceptConnections();
+    bool readFrom(Connection& connection);
+    bool parseRequests(Connection& connection, std::vector<Request>& requests);
+    void replyNow(Connection& connection, const SolverProtocol::Header& request, SolverProtocol::Status status,
+                  const void* payload, std::size_t length);
+    bool writeTo(Connection& connection);
+    void deliverCompleted();
+    void submitBatches(std::vector<Request>& requests);
+    void runBatch(std::vector<Request>& batch);
+    static void execute(const Request& request, Reply& reply);
+};
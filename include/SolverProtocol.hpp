@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Frames SolverDaemon and SolverClient exchange over a Unix domain socket. Both ends run on
+// the same machine, so fields are in host byte order. Every frame is a HEADER_BYTES header
+// followed by `length` payload bytes. A reply carries the id and type of its request.
+// Replies can come back in a different order than the requests went out. A request the daemon
+// could not carry out (it ran out of memory, say) is answered with status Failed and no payload.
+//
+//   request   option              payload                      reply payload
+//   Solve     Solver::Strategy    81 cells, 0 for empty        81 cells when Ok
+//   Unique    -                   81 cells                     -, status Ok, NotUnique or NoSolution
+//   Generate  GeneratorDifficulty 8 byte seed, or nothing      81 cells
+//                                 for a random puzzle
+//   Rate      -                   81 cells                     1 byte, PuzzleDatabase::rate
+//   Stats     -                   -                            JSON text
+//
+// A Generate seed is used whole: Generator seeds its generator with all 64 bits, so seeds that
+// differ only in their high half give different puzzles, and a seed gives the same puzzle as
+// `sudoku workers generate --seed`.
+class SolverProtocol {
+public:
+    enum class Type : std::uint8_t { Solve = 1, Unique, Generate, Rate, Stats };
+    enum class Status : std::uint8_t { Ok, NoSolution, NotUnique, BadRequest, Failed };
+
+    static constexpr int TYPE_COUNT = 5;
+    static constexpr std::size_t HEADER_BYTES = 12;
+    static constexpr std::size_t MAX_REQUEST_PAYLOAD = 96;   // longer requests close the connection
+    static constexpr std::size_t MAX_REPLY_PAYLOAD = 1 << 16;
+
+    struct Header {
+        std::uint32_t length;  // payload bytes
+        std::uint32_t id;      // chosen by the client
+        Type type;
+        std::uint8_t option;
+        Status status;         // replies only
+        std::uint8_t reserved;
+    };
+    static_assert(sizeof(Header) == HEADER_BYTES, "the header is sent as it is laid out");
+
+    static const char* typeName(Type type);
+    static const char* statusName(Status status);
+
+    static void writeHeader(const Header& header, std::uint8_t* out) { std::memcpy(out, &header, HEADER_BYTES); }
+    static Header readHeader(const std::uint8_t* in) {
+        Header header;
+        std::memcpy(&header, in, HEADER_BYTES);
+        return header;
+    }
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+// Counters filled by the Solver overloads that take a SolverStats&. Calls accumulate, clear()
+// between puzzles to look at them one at a time. The overloads without stats are compiled
+// from the same templates with every hook empty, so they do no extra work at all.
+struct SolverStats {
+    static constexpr int TECHNIQUE_COUNT = 7;
+    static const char* const TECHNIQUE_NAMES[TECHNIQUE_COUNT]; // in the order Solver tries them
+
+    struct Technique {
+        std::uint64_t runs = 0;
+        std::uint64_t placements = 0;
+        std::uint64_t eliminations = 0;   // candidates removed, including those a placement takes from its peers
+        std::uint64_t nanos = 0;
+    };
+
+    // backtracking search (BRUTE_FORCE, HYBRID after the techniques, countSolutions)
+    std::uint64_t nodes = 0;
+    std::uint64_t backtracks = 0;         // nodes where propagation ran into a contradiction
+    std::uint64_t propagations = 0;       // singles placed by propagation inside the search
+    int maxDepth = 0;
+
+    std::array<Technique, TECHNIQUE_COUNT> techniques;
+
+    std::uint64_t solveCalls = 0;
+    std::uint64_t countSolutionsCalls = 0;
+    std::uint64_t nanos = 0;              // wall time of all calls, any strategy
+
+    void clear() { *this = SolverStats(); }
+    void writeJson(std::ostream& out) const;
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers, each with its own task deque. A worker runs its newest task first
+// and steals the oldest task of another worker when its own deque is empty, so tasks that
+// fan out into subtasks stay local until some other worker runs dry.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = 0); // 0 = one per hardware thread
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // tasks submitted from a worker go to that worker's deque, others are spread round robin
+    void submit(std::function<void()> task);
+
+    // blocks until every submitted task has finished, rethrows the first exception a task threw.
+    // must not be called from a task
+    void waitIdle();
+
+    unsigned size() const { return static_cast<unsigned>(queues.size()); }
+    bool hasIdleWorkers() const { return idle.load(std::memory_order_relaxed) > 0; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::atomic<std::size_t> queued;   // tasks sitting in a deque
+    std::atomic<std::size_t> pending;  // tasks submitted and not yet finished
+    std::atomic<unsigned> idle;
+    std::atomic<unsigned> nextQueue;
+    std::exception_ptr firstError;
+    bool stopping;
+
+    // helpers
+    void workerLoop(unsigned index);
+    bool popOwn(unsigned index, std::function<void()>& task);
+    bool steal(unsigned thief, std::function<void()>& task);
+    void run(std::function<void()>& task);
+};
\ No newline at end of file
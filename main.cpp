@@ -0,0 +1,528 @@
+#include "Grid.hpp"
+#include "Solver.hpp"
+#include "BatchSolver.hpp"
+#include "PuzzleDatabase.hpp"
+#include "DedupIndex.hpp"
+#include "ProcessBatch.hpp"
+#include "SolverClient.hpp"
+#include "SolverDaemon.hpp"
+#include <algorithm>
+#include <cstring>
+#include <csignal>
+#include <exception>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    void printUsage(const char* program) {
+        std::cerr << "usage:\n"
+                  << "  " << program << "                         solve a puzzle typed on the console\n"
+                  << "  " << program << " batch <puzzles> [options]  solve one 81 character puzzle per line\n"
+                  << "  " << program << " stats <puzzle> [--strategy=NAME]  solve one puzzle, print solver statistics as JSON\n"
+                  << "  " << program << " pack <puzzles> <database> [--threads=N] [--no-rate]  convert 81 character lines to a puzzle database\n"
+                  << "  " << program << " unpack <database> [filter] [--output=PATH]  write a puzzle database back as 81 character lines\n"
+                  << "  " << program << " dedup <puzzles> [--threads=N] [--output=PATH]  drop puzzles equivalent to an earlier line\n"
+                  << "  " << program << " workers solve|unique <puzzles> [options]  solve or check one puzzle per line in worker processes\n"
+                  << "  " << program << " workers generate <count> [options]  generate puzzles in worker processes\n"
+                  << "  " << program << " serve <socket> [--threads=N] [--queue=N] [--batch=N]  run the solver daemon until SIGINT or SIGTERM\n"
+                  << "  " << program << " client <socket> solve|unique|rate <puzzles> [options]  send one puzzle per line to the daemon\n"
+                  << "  " << program << " client <socket> generate <count> [options]  have the daemon generate puzzles\n"
+                  << "  " << program << " client <socket> stats  print the daemon's counters and latencies as JSON\n"
+                  << "\nbatch options:\n"
+                  << "  --strategy=NAME   brute, human, hybrid, dlx or bitboard (default bitboard)\n"
+                  << "  --threads=N       worker threads (default: hardware threads)\n"
+                  << "  --output=PATH     write solutions to PATH instead of stdout\n"
+                  << "\nworkers options (and --strategy, --output as for batch):\n"
+                  << "  --processes=N     worker processes (default: hardware threads)\n"
+                  << "  --slots=N         jobs in flight in the shared memory ring (default 1024)\n"
+                  << "  --difficulty=NAME generate: easy, medium, hard or expert (default medium)\n"
+                  << "  --seed=N          generate: puzzle i comes from seed N + i (default 1)\n"
+                  << "\nclient options: --strategy, --difficulty, --seed and --output as above, and\n"
+                  << "  --window=N        requests in flight on the connection (default 256)\n"
+                  << "\nunpack filters, at most one:\n"
+                  << "  --rating=MIN[-MAX]  hardest technique needed, 1 + index in the HUMAN order, "
+                  << PuzzleDatabase::NEEDS_SEARCH << " needs search, " << PuzzleDatabase::NOT_UNIQUE << " not unique\n"
+                  << "  --clues=MIN[-MAX]   clue count\n"
+                  << "  --difficulty=NAME   easy, medium, hard or expert, by the clue counts the generator aims for\n";
+    }
+
+    // value of "--name=value", nullptr when arg is a different option
+    const char* optionValue(const char* arg, const char* name) {
+        const std::size_t length = std::strlen(name);
+        if (std::strncmp(arg, name, length) == 0 && arg[length] == '=') {
+            return arg + length + 1;
+        }
+        return nullptr;
+    }
+
+    // "N" or "MIN-MAX"
+    bool parseRange(const char* value, int& min, int& max) {
+        char* end;
+        min = max = static_cast<int>(std::strtol(value, &end, 10));
+        if (end == value) {
+            return false;
+        }
+        if (*end == '-') {
+            const char* second = end + 1;
+            max = static_cast<int>(std::strtol(second, &end, 10));
+            if (end == second) {
+                return false;
+            }
+        }
+        return *end == '\0';
+    }
+
+    bool parseDifficulty(const char* value, GeneratorDifficulty& difficulty) {
+        const struct { const char* name; GeneratorDifficulty difficulty; } names[] = {
+            {"easy", GeneratorDifficulty::EASY}, {"medium", GeneratorDifficulty::MEDIUM},
+            {"hard", GeneratorDifficulty::HARD}, {"expert", GeneratorDifficulty::EXPERT}
+        };
+        for (const auto& entry : names) {
+            if (std::strcmp(value, entry.name) == 0) {
+                difficulty = entry.difficulty;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int runInteractive() {
+        Grid grid;
+        grid.loadFromStrings(Grid::readPuzzleFromConsole());
+        if (!Solver::solve(grid, Solver::Strategy::HYBRID)) {
+            std::cout << "No solution found.\n";
+            return 1;
+        }
+        grid.prettyPrintBoard();
+        return 0;
+    }
+
+    int runStats(int argc, char** argv) {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        Solver::Strategy strategy = Solver::Strategy::HYBRID;
+        for (int i = 3; i < argc; ++i) {
+            const char* value = optionValue(argv[i], "--strategy");
+            if (!value || !Solver::parseStrategy(value, strategy)) {
+                std::cerr << "unknown option: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+
+        Grid grid;
+        const ParseResult parsed = grid.parse(argv[2]);
+        if (!parsed) {
+            std::cerr << "stats: " << parseStatusName(parsed.status) << " at offset " << parsed.offset << "\n";
+            return 2;
+        }
+        SolverStats stats;
+        const bool solved = Solver::solve(grid, strategy, stats);
+        stats.writeJson(std::cout);
+        std::cerr << Solver::strategyName(strategy) << ": " << (solved ? "solved" : "not solved") << "\n";
+        return solved ? 0 : 1;
+    }
+
+    int runBatch(int argc, char** argv) {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        BatchSolver::Options options;
+        const char* outputPath = nullptr;
+        for (int i = 3; i < argc; ++i) {
+            if (const char* value = optionValue(argv[i], "--strategy")) {
+                if (!Solver::parseStrategy(value, options.strategy)) {
+                    std::cerr << "unknown strategy: " << value << "\n";
+                    return 2;
+                }
+            }
+            else if (const char* value = optionValue(argv[i], "--threads")) {
+                options.threads = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+            }
+            else if (const char* value = optionValue(argv[i], "--output")) {
+                outputPath = value;
+            }
+            else {
+                std::cerr << "unknown option: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+
+        int outputFd = STDOUT_FILENO;
+        if (outputPath) {
+            outputFd = ::open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (outputFd < 0) {
+                std::cerr << "cannot open " << outputPath << ": " << std::strerror(errno) << "\n";
+                return 1;
+            }
+        }
+
+        const BatchSolver::Summary summary = BatchSolver::run(argv[2], outputFd, options);
+        if (outputPath) {
+            ::close(outputFd);
+        }
+        std::cerr << "strategy:   " << Solver::strategyName(options.strategy) << "\n";
+        BatchSolver::printSummary(summary, std::cerr);
+        return 0;
+    }
+
+    int runPack(int argc, char** argv) {
+        if (argc < 4) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        PuzzleDatabase::PackOptions options;
+        for (int i = 4; i < argc; ++i) {
+            if (const char* value = optionValue(argv[i], "--threads")) {
+                options.threads = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--no-rate") == 0) {
+                options.rate = false;
+            }
+            else {
+                std::cerr << "unknown option: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+
+        const PuzzleDatabase::PackSummary summary = PuzzleDatabase::pack(argv[2], argv[3], options);
+        std::cerr << "puzzles:    " << summary.puzzles << " (" << summary.skipped << " lines skipped)\n"
+                  << "wall time:  " << summary.seconds << " s\n";
+        return 0;
+    }
+
+    int runDedup(int argc, char** argv) {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        unsigned threads = 0;
+        const char* outputPath = nullptr;
+        for (int i = 3; i < argc; ++i) {
+            if (const char* value = optionValue(argv[i], "--threads")) {
+                threads = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+            }
+            else if (const char* value = optionValue(argv[i], "--output")) {
+                outputPath = value;
+            }
+            else {
+                std::cerr << "unknown option: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+
+        int outputFd = STDOUT_FILENO;
+        if (outputPath) {
+            outputFd = ::open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (outputFd < 0) {
+                std::cerr << "cannot open " << outputPath << ": " << std::strerror(errno) << "\n";
+                return 1;
+            }
+        }
+
+        DedupIndex index;
+        const DedupIndex::Summary summary = index.filter(argv[2], outputFd, threads);
+        if (outputPath) {
+            ::close(outputFd);
+        }
+        std::cerr << "puzzles:    " << summary.puzzles << " (" << summary.duplicates << " duplicates, "
+                  << summary.skipped << " lines skipped)\n"
+                  << "wall time:  " << summary.seconds << " s\n";
+        return 0;
+    }
+
+    int runWorkers(int argc, char** argv) {
+        if (argc < 4) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        ProcessBatch::Options options;
+        if (std::strcmp(argv[2], "solve") == 0) {
+            options.job = SharedRing::Job::Solve;
+        }
+        else if (std::strcmp(argv[2], "unique") == 0) {
+            options.job = SharedRing::Job::Unique;
+        }
+        else if (std::strcmp(argv[2], "generate") == 0) {
+            options.job = SharedRing::Job::Generate;
+        }
+        else {
+            std::cerr << "unknown job: " << argv[2] << "\n";
+            return 2;
+        }
+
+        const char* outputPath = nullptr;
+        for (int i = 4; i < argc; ++i) {
+            const char* value;
+            if ((value = optionValue(argv[i], "--strategy"))) {
+                if (!Solver::parseStrategy(value, options.strategy)) {
+                    std::cerr << "unknown strategy: " << value << "\n";
+                    return 2;
+                }
+            }
+            else if ((value = optionValue(argv[i], "--difficulty"))) {
+                if (!parseDifficulty(value, options.difficulty)) {
+                    std::cerr << "unknown difficulty: " << value << "\n";
+                    return 2;
+                }
+            }
+            else if ((value = optionValue(argv[i], "--processes"))) {
+                options.processes = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+            }
+            else if ((value = optionValue(argv[i], "--slots"))) {
+                options.slots = std::strtoull(value, nullptr, 10);
+            }
+            else if ((value = optionValue(argv[i], "--seed"))) {
+                options.seed = std::strtoull(value, nullptr, 10);
+            }
+            else if ((value = optionValue(argv[i], "--output"))) {
+                outputPath = value;
+            }
+            else {
+                std::cerr << "unknown option: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+
+        int outputFd = STDOUT_FILENO;
+        if (outputPath) {
+            outputFd = ::open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (outputFd < 0) {
+                std::cerr << "cannot open " << outputPath << ": " << std::strerror(errno) << "\n";
+                return 1;
+            }
+        }
+
+        const ProcessBatch::Summary summary = options.job == SharedRing::Job::Generate
+            ? ProcessBatch::generate(std::strtoull(argv[3], nullptr, 10), outputFd, options)
+            : ProcessBatch::run(argv[3], outputFd, options);
+        if (outputPath) {
+            ::close(outputFd);
+        }
+        ProcessBatch::printSummary(summary, std::cerr);
+        return 0;
+    }
+
+    SolverDaemon* runningDaemon = nullptr;
+
+    void stopDaemon(int) {
+        runningDaemon->stop();
+    }
+
+    int runServe(int argc, char** argv) {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        SolverDaemon::Options options;
+        options.socketPath = argv[2];
+        for (int i = 3; i < argc; ++i) {
+            const char* value;
+            if ((value = optionValue(argv[i], "--threads"))) {
+                options.threads = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+            }
+            else if ((value = optionValue(argv[i], "--queue"))) {
+                options.maxQueued = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+            }
+            else if ((value = optionValue(argv[i], "--batch"))) {
+                options.maxBatch = std::strtoull(value, nullptr, 10);
+            }
+            else {
+                std::cerr << "unknown option: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+
+        SolverDaemon daemon(options);
+        runningDaemon = &daemon;
+        std::signal(SIGINT, stopDaemon);
+        std::signal(SIGTERM, stopDaemon);
+        std::cerr << "listening on " << options.socketPath << "\n";
+        daemon.run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        runningDaemon = nullptr;
+        std::cerr << daemon.statsJson() << "\n";
+        return 0;
+    }
+
+    int runClient(int argc, char** argv) {
+        if (argc < 4) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        SolverClient::RunOptions options;
+        const char* job = argv[3];
+        if (std::strcmp(job, "stats") == 0) {
+            SolverClient client(argv[2]);
+            std::cout << client.stats() << "\n";
+            return 0;
+        }
+        if (argc < 5) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        const struct { const char* name; SolverProtocol::Type type; } jobs[] = {
+            {"solve", SolverProtocol::Type::Solve}, {"unique", SolverProtocol::Type::Unique},
+            {"rate", SolverProtocol::Type::Rate}, {"generate", SolverProtocol::Type::Generate}
+        };
+        const auto found = std::find_if(std::begin(jobs), std::end(jobs), [&](const auto& entry) { return std::strcmp(job, entry.name) == 0; });
+        if (found == std::end(jobs)) {
+            std::cerr << "unknown job: " << job << "\n";
+            return 2;
+        }
+        options.type = found->type;
+
+        const char* outputPath = nullptr;
+        for (int i = 5; i < argc; ++i) {
+            const char* value;
+            if ((value = optionValue(argv[i], "--strategy"))) {
+                if (!Solver::parseStrategy(value, options.strategy)) {
+                    std::cerr << "unknown strategy: " << value << "\n";
+                    return 2;
+                }
+            }
+            else if ((value = optionValue(argv[i], "--difficulty"))) {
+                if (!parseDifficulty(value, options.difficulty)) {
+                    std::cerr << "unknown difficulty: " << value << "\n";
+                    return 2;
+                }
+            }
+            else if ((value = optionValue(argv[i], "--seed"))) {
+                options.seeded = true;
+                options.seed = std::strtoull(value, nullptr, 10);
+            }
+            else if ((value = optionValue(argv[i], "--window"))) {
+                options.window = std::max<std::size_t>(1, std::strtoull(value, nullptr, 10));
+            }
+            else if ((value = optionValue(argv[i], "--output"))) {
+                outputPath = value;
+            }
+            else {
+                std::cerr << "unknown option: " << argv[i] << "\n";
+                return 2;
+            }
+        }
+
+        int outputFd = STDOUT_FILENO;
+        if (outputPath) {
+            outputFd = ::open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (outputFd < 0) {
+                std::cerr << "cannot open " << outputPath << ": " << std::strerror(errno) << "\n";
+                return 1;
+            }
+        }
+
+        const SolverClient::RunSummary summary = options.type == SolverProtocol::Type::Generate
+            ? SolverClient::runGenerate(argv[2], std::strtoull(argv[4], nullptr, 10), outputFd, options)
+            : SolverClient::runFile(argv[2], argv[4], outputFd, options);
+        if (outputPath) {
+            ::close(outputFd);
+        }
+        SolverClient::printSummary(summary, std::cerr);
+        return 0;
+    }
+
+    int runUnpack(int argc, char** argv) {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+        enum class Filter { None, Rating, Clues, Difficulty } filter = Filter::None;
+        int min = 0, max = 0;
+        GeneratorDifficulty difficulty = GeneratorDifficulty::EASY;
+        const char* outputPath = nullptr;
+        for (int i = 3; i < argc; ++i) {
+            const char* value;
+            Filter next = Filter::None;
+            if ((value = optionValue(argv[i], "--rating")) && parseRange(value, min, max)) {
+                next = Filter::Rating;
+            }
+            else if ((value = optionValue(argv[i], "--clues")) && parseRange(value, min, max)) {
+                next = Filter::Clues;
+            }
+            else if ((value = optionValue(argv[i], "--difficulty")) && parseDifficulty(value, difficulty)) {
+                next = Filter::Difficulty;
+            }
+            else if ((value = optionValue(argv[i], "--output"))) {
+                outputPath = value;
+                continue;
+            }
+            if (next == Filter::None || filter != Filter::None) {
+                std::cerr << (next == Filter::None ? "unknown option: " : "only one filter allowed: ") << argv[i] << "\n";
+                return 2;
+            }
+            filter = next;
+        }
+
+        const PuzzleDatabase database(argv[2]);
+        int outputFd = STDOUT_FILENO;
+        if (outputPath) {
+            outputFd = ::open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (outputFd < 0) {
+                std::cerr << "cannot open " << outputPath << ": " << std::strerror(errno) << "\n";
+                return 1;
+            }
+        }
+
+        switch (filter) {
+            case Filter::None:       database.writeText(outputFd); break;
+            case Filter::Rating:     database.writeText(outputFd, database.withRating(min, max)); break;
+            case Filter::Clues:      database.writeText(outputFd, database.withClues(min, max)); break;
+            case Filter::Difficulty: database.writeText(outputFd, database.withDifficulty(difficulty)); break;
+        }
+        if (outputPath) {
+            ::close(outputFd);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc < 2) {
+            return runInteractive();
+        }
+        if (std::strcmp(argv[1], "batch") == 0) {
+            return runBatch(argc, argv);
+        }
+        if (std::strcmp(argv[1], "stats") == 0) {
+            return runStats(argc, argv);
+        }
+        if (std::strcmp(argv[1], "pack") == 0) {
+            return runPack(argc, argv);
+        }
+        if (std::strcmp(argv[1], "unpack") == 0) {
+            return runUnpack(argc, argv);
+        }
+        if (std::strcmp(argv[1], "dedup") == 0) {
+            return runDedup(argc, argv);
+        }
+        if (std::strcmp(argv[1], "workers") == 0) {
+            return runWorkers(argc, argv);
+        }
+        if (std::strcmp(argv[1], "serve") == 0) {
+            return runServe(argc, argv);
+        }
+        if (std::strcmp(argv[1], "client") == 0) {
+            return runClient(argc, argv);
+        }
+        printUsage(argv[0]);
+        return 2;
+    }
+    catch (const std::exception& error) {
+        std::cerr << "error: " << error.what() << "\n";
+        return 1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,271 @@
+// Bit-parallel search kernel, included by BandSolver.cpp once per instruction set.
+// The including namespace provides Board (three 27-bit bands plus an unused lane)
+// with &, |, andNot, isZero, intersects, popcount, store and load.
+
+namespace {
+    struct State {
+        Board digits[DIGITS]; // cells each digit may occupy, a solved cell keeps only its digit
+        Board unsolved;
+    };
+
+    struct Frame {
+        int cell;
+        unsigned remaining; // digits still to try at this cell
+    };
+
+    inline void place(State& state, int cell, int digit) {
+        const Board bit = Board::load(TABLES.cell[cell]);
+        #pragma GCC unroll 9
+        for (int d = 0; d < DIGITS; ++d) {
+            state.digits[d] = andNot(state.digits[d], bit);
+        }
+        state.digits[digit] = andNot(state.digits[digit], Board::load(TABLES.peers[cell])) | bit;
+        state.unsolved = andNot(state.unsolved, bit);
+    }
+
+    inline unsigned digitsAt(const State& state, int cell) {
+        const Board bit = Board::load(TABLES.cell[cell]);
+        unsigned mask = 0;
+        #pragma GCC unroll 9
+        for (int d = 0; d < DIGITS; ++d) {
+            if (state.digits[d].intersects(bit)) {
+                mask |= 1u << d;
+            }
+        }
+        return mask;
+    }
+
+    // places every cell of the board whose single remaining digit can be found, false on a dead cell
+    inline bool placeNakedSingles(State& state, const Board& singles) {
+        std::uint32_t lanes[4];
+        singles.store(lanes);
+        for (int lane = 0; lane < BANDS; ++lane) {
+            for (std::uint32_t bits = lanes[lane]; bits; bits &= bits - 1) {
+                const int cell = lane * BAND_CELLS + __builtin_ctz(bits);
+                const unsigned options = digitsAt(state, cell);
+                if (options == 0) {
+                    return false;
+                }
+                place(state, cell, __builtin_ctz(options));
+            }
+        }
+        return true;
+    }
+
+    // cells of one band that are the only spot for the digit in their row, column or box.
+    // lanes holds the digit's board, false when some unit has no spot left at all
+    inline bool hiddenSinglesOf(const std::uint32_t* lanes, std::uint32_t* singles) {
+        std::uint32_t once = 0;
+        std::uint32_t twice = 0;
+        for (int lane = 0; lane < BANDS; ++lane) {
+            const std::uint32_t bits = lanes[lane];
+            std::uint32_t found = 0;
+            for (int i = 0; i < BANDS; ++i) {
+                const std::uint32_t row = (bits >> (i * DIGITS)) & ALL_DIGITS;
+                const std::uint32_t box = bits & (BOX_COLUMNS << (i * BANDS));
+                if (row == 0 || box == 0) {
+                    return false;
+                }
+                if ((row & (row - 1)) == 0) {
+                    found |= row << (i * DIGITS);
+                }
+                if ((box & (box - 1)) == 0) {
+                    found |= box;
+                }
+                twice |= once & row;
+                once |= row;
+            }
+            singles[lane] = found;
+        }
+        if (once != ALL_DIGITS) {
+            return false;
+        }
+
+        const std::uint32_t columns = once & ~twice;
+        for (int lane = 0; lane < BANDS; ++lane) {
+            for (int i = 0; i < BANDS; ++i) {
+                singles[lane] |= (lanes[lane] & (columns << (i * DIGITS)));
+            }
+        }
+        return true;
+    }
+
+    // places every hidden single, returns -1 on contradiction, otherwise whether anything was placed
+    inline int placeHiddenSingles(State& state) {
+        int placed = 0;
+        for (int d = 0; d < DIGITS; ++d) {
+            if ((state.digits[d] & state.unsolved).isZero()) {
+                continue;
+            }
+            std::uint32_t lanes[4];
+            std::uint32_t open[4];
+            std::uint32_t singles[BANDS];
+            state.digits[d].store(lanes);
+            state.unsolved.store(open);
+            if (!hiddenSinglesOf(lanes, singles)) {
+                return -1;
+            }
+            for (int lane = 0; lane < BANDS; ++lane) {
+                for (std::uint32_t bits = singles[lane] & open[lane]; bits; bits &= bits - 1) {
+                    const int cell = lane * BAND_CELLS + __builtin_ctz(bits);
+                    if (!state.digits[d].intersects(Board::load(TABLES.cell[cell]))) {
+                        return -1;
+                    }
+                    place(state, cell, d);
+                    placed = 1;
+                }
+            }
+        }
+        return placed;
+    }
+
+    inline bool propagate(State& state) {
+        for (;;) {
+            Board once = Board::zero();
+            Board twice = Board::zero();
+            #pragma GCC unroll 9
+            for (int d = 0; d < DIGITS; ++d) {
+                const Board open = state.digits[d] & state.unsolved;
+                twice = twice | (once & open);
+                once = once | open;
+            }
+            if (!andNot(state.unsolved, once).isZero()) {
+                return false;
+            }
+
+            const Board singles = andNot(once, twice);
+            if (!singles.isZero()) {
+                if (!placeNakedSingles(state, singles)) {
+                    return false;
+                }
+                continue;
+            }
+
+            const int hidden = placeHiddenSingles(state);
+            if (hidden < 0) {
+                return false;
+            }
+            if (hidden == 0) {
+                return true;
+            }
+        }
+    }
+
+    // bivalue cells first, otherwise the unsolved cell with the fewest digits
+    inline int chooseCell(const State& state) {
+        Board once = Board::zero();
+        Board twice = Board::zero();
+        Board thrice = Board::zero();
+        #pragma GCC unroll 9
+        for (int d = 0; d < DIGITS; ++d) {
+            const Board open = state.digits[d] & state.unsolved;
+            thrice = thrice | (twice & open);
+            twice = twice | (once & open);
+            once = once | open;
+        }
+
+        std::uint32_t lanes[4];
+        andNot(twice, thrice).store(lanes);
+        for (int lane = 0; lane < BANDS; ++lane) {
+            if (lanes[lane]) {
+                return lane * BAND_CELLS + __builtin_ctz(lanes[lane]);
+            }
+        }
+
+        int best = -1;
+        int fewest = DIGITS + 1;
+        state.unsolved.store(lanes);
+        for (int lane = 0; lane < BANDS && fewest > 3; ++lane) {
+            for (std::uint32_t bits = lanes[lane]; bits; bits &= bits - 1) {
+                const int cell = lane * BAND_CELLS + __builtin_ctz(bits);
+                const int count = __builtin_popcount(digitsAt(state, cell));
+                if (count < fewest) {
+                    fewest = count;
+                    best = cell;
+                }
+            }
+        }
+        return best;
+    }
+
+    inline void writeSolution(const State& state, std::uint8_t* solution) {
+        for (int cell = 0; cell < CELLS; ++cell) {
+            solution[cell] = static_cast<std::uint8_t>(__builtin_ctz(digitsAt(state, cell)) + 1);
+        }
+    }
+
+}
+
+int solve(const std::uint8_t* cells, const std::uint16_t* masks, std::uint8_t* solution, int limit) {
+    State stack[CELLS + 1];
+    Frame frames[CELLS];
+
+    State& root = stack[0];
+    for (int d = 0; d < DIGITS; ++d) {
+        root.digits[d] = Board::load(TABLES.all);
+    }
+    root.unsolved = Board::load(TABLES.all);
+
+    for (int cell = 0; cell < CELLS; ++cell) {
+        const int value = cells[cell];
+        if (value != 0) {
+            if (!root.digits[value - 1].intersects(Board::load(TABLES.cell[cell]))) {
+                return 0;
+            }
+            place(root, cell, value - 1);
+        }
+    }
+    if (masks) {
+        for (int cell = 0; cell < CELLS; ++cell) {
+            if (cells[cell] == 0) {
+                const Board bit = Board::load(TABLES.cell[cell]);
+                for (unsigned excluded = ~masks[cell] & ALL_DIGITS; excluded; excluded &= excluded - 1) {
+                    const int d = __builtin_ctz(excluded);
+                    root.digits[d] = andNot(root.digits[d], bit);
+                }
+            }
+        }
+    }
+
+    int found = 0;
+    int depth = 0;
+    bool descend = true;
+    while (limit > found) {
+        if (descend) {
+            State& state = stack[depth];
+            if (propagate(state)) {
+                if (state.unsolved.isZero()) {
+                    if (found++ == 0 && solution) {
+                        writeSolution(state, solution);
+                    }
+                }
+                else {
+                    const int cell = chooseCell(state);
+                    const unsigned options = digitsAt(state, cell);
+                    const int digit = __builtin_ctz(options);
+                    frames[depth] = {cell, options & (options - 1)};
+                    stack[depth + 1] = state;
+                    place(stack[depth + 1], cell, digit);
+                    ++depth;
+                    continue;
+                }
+            }
+        }
+
+        // backtrack to the deepest frame with an untried digit
+        descend = false;
+        while (depth > 0 && frames[depth - 1].remaining == 0) {
+            --depth;
+        }
+        if (depth == 0) {
+            break;
+        }
+        Frame& frame = frames[depth - 1];
+        const int digit = __builtin_ctz(frame.remaining);
+        frame.remaining &= frame.remaining - 1;
+        stack[depth] = stack[depth - 1];
+        place(stack[depth], frame.cell, digit);
+        descend = true;
+    }
+    return found;
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "BandSolver.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BAND_SOLVER_X86 1
+#else
+#define BAND_SOLVER_X86 0
+#endif
+
+namespace {
+    constexpr int DIGITS = Grid::GRID_SIZE;
+    constexpr int CELLS = Grid::CELL_COUNT;
+    constexpr int BANDS = Grid::SUBGRID_SIZE;
+    constexpr int BAND_CELLS = CELLS / BANDS;
+    constexpr unsigned ALL_DIGITS = Grid::ALL_MASK;
+    constexpr std::uint32_t BOX_COLUMNS = 0x7u | 0x7u << 9 | 0x7u << 18; // first box of a band
+
+    // lane = band, bit = cell within the band, lane 3 stays zero
+    struct alignas(16) Bits {
+        std::uint32_t lane[4];
+    };
+
+    struct Tables {
+        Bits cell[CELLS];
+        Bits peers[CELLS];
+        Bits all;
+    };
+
+    constexpr void setCell(Bits& bits, int cell) {
+        bits.lane[cell / BAND_CELLS] |= 1u << (cell % BAND_CELLS);
+    }
+
+    constexpr Tables buildTables() {
+        Tables tables = {};
+        for (int cell = 0; cell < CELLS; ++cell) {
+            const int row = cell / DIGITS;
+            const int col = cell % DIGITS;
+            setCell(tables.cell[cell], cell);
+            setCell(tables.all, cell);
+            for (int other = 0; other < CELLS; ++other) {
+                const int r = other / DIGITS;
+                const int c = other % DIGITS;
+                const bool sameBox = Grid::getBoxIndex(row, col) == Grid::getBoxIndex(r, c);
+                if (other != cell && (r == row || c == col || sameBox)) {
+                    setCell(tables.peers[cell], other);
+                }
+            }
+        }
+        return tables;
+    }
+
+    constexpr Tables TABLES = buildTables();
+
+    using KernelFn = int (*)(const std::uint8_t*, const std::uint16_t*, std::uint8_t*, int);
+}
+
+namespace scalar_kernel {
+    namespace {
+        struct Board {
+            std::uint32_t lane[BANDS];
+
+            static Board load(const Bits& bits) { return {{bits.lane[0], bits.lane[1], bits.lane[2]}}; }
+            static Board zero() { return {{0, 0, 0}}; }
+
+            Board operator&(const Board& other) const {
+                return {{lane[0] & other.lane[0], lane[1] & other.lane[1], lane[2] & other.lane[2]}};
+            }
+            Board operator|(const Board& other) const {
+                return {{lane[0] | other.lane[0], lane[1] | other.lane[1], lane[2] | other.lane[2]}};
+            }
+            bool isZero() const { return (lane[0] | lane[1] | lane[2]) == 0; }
+            bool intersects(const Board& other) const { return !(*this & other).isZero(); }
+            int popcount() const {
+                return __builtin_popcount(lane[0]) + __builtin_popcount(lane[1]) + __builtin_popcount(lane[2]);
+            }
+            void store(std::uint32_t* out) const {
+                out[0] = lane[0];
+                out[1] = lane[1];
+                out[2] = lane[2];
+                out[3] = 0;
+            }
+        };
+
+        inline Board andNot(const Board& a, const Board& b) {
+            return {{a.lane[0] & ~b.lane[0], a.lane[1] & ~b.lane[1], a.lane[2] & ~b.lane[2]}};
+        }
+    }
+
+#include "BandKernel.inl"
+}
+
+#if BAND_SOLVER_X86
+// the vector kernels are compiled for their own target and only called after a CPU check
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse4.1,popcnt"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("sse4.1,popcnt")
+#endif
+namespace sse41_kernel {
+#include "BandVectorBoard.inl"
+#include "BandKernel.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,bmi,popcnt"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,bmi,popcnt")
+#endif
+namespace avx2_kernel {
+#include "BandVectorBoard.inl"
+#include "BandKernel.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+namespace {
+    struct Kernel {
+        KernelFn solve;
+        const char* name;
+    };
+
+    Kernel selectKernel() {
+#if BAND_SOLVER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("popcnt")) {
+            return {avx2_kernel::solve, "avx2"};
+        }
+        if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt")) {
+            return {sse41_kernel::solve, "sse4.1"};
+        }
+#endif
+        return {scalar_kernel::solve, "scalar"};
+    }
+
+    const Kernel& activeKernel() {
+        static const Kernel kernel = selectKernel();
+        return kernel;
+    }
+}
+
+int BandSolver::solve(const Grid& grid, int limit, Grid* solution) {
+    std::uint8_t solved[CELLS];
+    const int found = activeKernel().solve(grid.getCells().data(), grid.getCandidateMasks().data(),
+                                           solution ? solved : nullptr, limit);
+    if (found > 0 && solution) {
+        for (int cell = 0; cell < CELLS; ++cell) {
+            if (grid.cellValue(cell) == Grid::EMPTY) {
+                solution->set(cell / DIGITS, cell % DIGITS, solved[cell]);
+            }
+        }
+    }
+    return found;
+}
+
+int BandSolver::solveCells(const std::uint8_t* cells, std::uint8_t* solution, int limit) {
+    return activeKernel().solve(cells, nullptr, solution, limit);
+}
+
+const char* BandSolver::kernelName() {
+    return activeKernel().name;
+}
\ No newline at end of file
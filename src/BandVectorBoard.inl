@@ -0,0 +1,23 @@
+// 128-bit Board for the vector kernels, included by BandSolver.cpp inside a target region.
+
+namespace {
+    struct Board {
+        __m128i v;
+
+        static Board load(const Bits& bits) { return {_mm_load_si128(reinterpret_cast<const __m128i*>(bits.lane))}; }
+        static Board zero() { return {_mm_setzero_si128()}; }
+
+        Board operator&(const Board& other) const { return {_mm_and_si128(v, other.v)}; }
+        Board operator|(const Board& other) const { return {_mm_or_si128(v, other.v)}; }
+        bool isZero() const { return _mm_testz_si128(v, v); }
+        bool intersects(const Board& other) const { return !_mm_testz_si128(v, other.v); }
+        int popcount() const {
+            return _mm_popcnt_u32(static_cast<unsigned>(_mm_cvtsi128_si32(v))) +
+                   _mm_popcnt_u32(static_cast<unsigned>(_mm_extract_epi32(v, 1))) +
+                   _mm_popcnt_u32(static_cast<unsigned>(_mm_extract_epi32(v, 2)));
+        }
+        void store(std::uint32_t* out) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v); }
+    };
+
+    inline Board andNot(const Board& a, const Board& b) { return {_mm_andnot_si128(b.v, a.v)}; }
+}
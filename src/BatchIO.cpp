@@ -0,0 +1,40 @@
+#include "BatchIO.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::vector<BatchIO::Chunk> BatchIO::split(const char* data, std::size_t size, std::size_t chunkBytes) {
+    chunkBytes = std::max<std::size_t>(chunkBytes, 1);
+    std::vector<Chunk> chunks;
+    chunks.reserve(size / chunkBytes + 1);   // every chunk but the last has at least chunkBytes
+    const char* const end = data + size;
+    const char* begin = data;
+    while (begin < end) {
+        const char* cut = begin + std::min<std::size_t>(chunkBytes, end - begin);
+        if (cut < end) {
+            const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+            cut = newline ? newline + 1 : end;
+        }
+        chunks.push_back({begin, cut});
+        begin = cut;
+    }
+    return chunks;
+}
+
+void BatchIO::writeAll(int fd, const void* data, std::size_t size, const char* owner, int flags) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t written = flags ? ::send(fd, bytes, size, flags) : ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string(owner) + " - Write failed: " + std::strerror(errno));
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
@@ -0,0 +1,186 @@
+#include "BatchSolver.hpp"
+#include "BandSolver.hpp"
+#include "BatchIO.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    using Chunk = BatchIO::Chunk;
+
+    struct ChunkResult {
+        std::string output;
+        bool done = false;
+    };
+
+    enum class Outcome { Solved, Unsolved, Invalid };
+
+    Outcome solveLine(const char* line, std::size_t length, Solver::Strategy strategy, char* solution) {
+        std::uint8_t cells[Grid::CELL_COUNT];
+        if (!Grid::parseCells(std::string_view(line, length), cells)) {
+            return Outcome::Invalid;
+        }
+
+        std::uint8_t solved[Grid::CELL_COUNT];
+        if (strategy == Solver::Strategy::BITBOARD) {
+            if (BandSolver::solveCells(cells, solved, 1) != 1) {
+                return Outcome::Unsolved;
+            }
+        }
+        else {
+            Grid grid;
+            grid.loadFromCells(cells);
+            if (!Solver::solve(grid, strategy) || !grid.isComplete()) {
+                return Outcome::Unsolved;
+            }
+            std::copy(grid.getCells().begin(), grid.getCells().end(), solved);
+        }
+
+        for (int i = 0; i < Grid::CELL_COUNT; ++i) {
+            solution[i] = static_cast<char>('0' + solved[i]);
+        }
+        return Outcome::Solved;
+    }
+
+    void solveChunk(const Chunk& chunk, Solver::Strategy strategy, ChunkResult& result, BatchSolver::Summary& summary) {
+        result.output.reserve(static_cast<std::size_t>(chunk.end - chunk.begin) + 64);
+        char solution[Grid::CELL_COUNT];
+
+        std::string_view line;
+        for (const char* next = chunk.begin; BatchIO::nextLine(next, chunk.end, line);) {
+            const Clock::time_point start = Clock::now();
+            const Outcome outcome = solveLine(line.data(), line.size(), strategy, solution);
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+            summary.latency.record(static_cast<std::uint64_t>(elapsed.count()));
+            ++summary.puzzles;
+
+            switch (outcome) {
+                case Outcome::Solved:
+                    ++summary.solved;
+                    result.output.append(solution, Grid::CELL_COUNT);
+                    break;
+                case Outcome::Unsolved:
+                    ++summary.unsolved;
+                    result.output.append(line).append(" unsolved");
+                    break;
+                case Outcome::Invalid:
+                    ++summary.invalid;
+                    result.output.append(line).append(" invalid");
+                    break;
+            }
+            result.output.push_back('\n');
+        }
+    }
+}
+
+BatchSolver::Summary BatchSolver::run(const std::string& inputPath, int outputFd, const Options& options) {
+    const Clock::time_point start = Clock::now();
+    const MappedFile input(inputPath);
+    const std::vector<Chunk> chunks = BatchIO::split(input.data(), input.size(), options.chunkBytes);
+
+    const unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t window = options.chunksInFlight ? options.chunksInFlight : 4 * static_cast<std::size_t>(threads);
+
+    // chunk i goes to slot i % slots. A worker only takes a chunk once the writer is done with
+    // the one before it in the same slot, so buffers are reused and never freed mid run
+    const std::size_t slots = std::max<std::size_t>(1, std::min(window, chunks.size()));
+    std::vector<ChunkResult> results(slots);
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t nextChunk = 0;
+    std::size_t written = 0;
+    bool aborted = false;
+
+    Summary summary;
+
+    // workers stay at most `window` chunks ahead of the writer so buffered output stays bounded
+    auto worker = [&]() {
+        Summary local;
+        for (;;) {
+            std::size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return aborted || nextChunk >= chunks.size() || nextChunk < written + window; });
+                if (aborted || nextChunk >= chunks.size()) {
+                    break;
+                }
+                index = nextChunk++;
+            }
+            solveChunk(chunks[index], options.strategy, results[index % slots], local);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                results[index % slots].done = true;
+            }
+            changed.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        summary.puzzles += local.puzzles;
+        summary.solved += local.solved;
+        summary.unsolved += local.unsolved;
+        summary.invalid += local.invalid;
+        summary.latency.merge(local.latency);
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+
+    try {
+        for (std::size_t index = 0; index < chunks.size(); ++index) {
+            ChunkResult& result = results[index % slots];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return result.done; });
+            }
+            BatchIO::writeAll(outputFd, result.output.data(), result.output.size(), "BatchSolver");
+            result.output.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                result.done = false;
+                written = index + 1;
+            }
+            changed.notify_all();
+        }
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            aborted = true;
+        }
+        changed.notify_all();
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+        throw;
+    }
+
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return summary;
+}
+
+void BatchSolver::printSummary(const Summary& summary, std::ostream& out) {
+    const double rate = summary.seconds > 0 ? summary.puzzles / summary.seconds : 0.0;
+    out << std::fixed << std::setprecision(2)
+        << "puzzles:    " << summary.puzzles << " (" << summary.solved << " solved, "
+        << summary.unsolved << " unsolved, " << summary.invalid << " invalid)\n"
+        << "wall time:  " << summary.seconds << " s\n"
+        << "throughput: " << rate << " puzzles/s\n"
+        << "latency:    p50 " << summary.latency.percentile(0.50) / 1000.0 << " us, p99 "
+        << summary.latency.percentile(0.99) / 1000.0 << " us, max "
+        << summary.latency.max() / 1000.0 << " us\n";
+}
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "Canonical.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr int SIZE = Grid::GRID_SIZE;
+    constexpr int CELLS = Grid::CELL_COUNT;
+    constexpr int PERM_COUNT = 6 * 6 * 6 * 6; // stack order, then the columns of each stack
+
+    static_assert(SIZE == 9, "Canonical - 9x9 boards only");
+
+    constexpr std::uint8_t ORDERS[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+    // column permutations as new column -> old column
+    struct ColumnPerms {
+        std::array<std::array<std::uint8_t, SIZE>, PERM_COUNT> columns{};
+
+        constexpr ColumnPerms() {
+            int perm = 0;
+            for (int stacks = 0; stacks < 6; ++stacks) {
+                for (int first = 0; first < 6; ++first) {
+                    for (int second = 0; second < 6; ++second) {
+                        for (int third = 0; third < 6; ++third) {
+                            const int inside[3] = {first, second, third};
+                            for (int col = 0; col < SIZE; ++col) {
+                                const int stack = ORDERS[stacks][col / 3];
+                                columns[perm][col] = static_cast<std::uint8_t>(3 * stack + ORDERS[inside[col / 3]][col % 3]);
+                            }
+                            ++perm;
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    constexpr ColumnPerms PERMS;
+
+    // column perms that move the clues of a stack behind its empty cells: bit p set when
+    // ORDERS[p] turns stack mask m (bit 2 = first column) into 0...01...1
+    struct ZerosFirst {
+        std::uint8_t perms[8]{};
+
+        constexpr ZerosFirst() {
+            for (int mask = 0; mask < 8; ++mask) {
+                const int clues = (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1);
+                for (int p = 0; p < 6; ++p) {
+                    int moved = 0;
+                    for (int col = 0; col < 3; ++col) {
+                        moved |= (mask >> (2 - ORDERS[p][col]) & 1) << (2 - col);
+                    }
+                    if (moved == (1 << clues) - 1) {
+                        perms[mask] |= static_cast<std::uint8_t>(1 << p);
+                    }
+                }
+            }
+        }
+    };
+
+    constexpr ZerosFirst ZEROS_FIRST;
+
+    // rows taken while every row so far came out empty: then all column perms are still tied,
+    // so they stay implicit
+    struct Prefix {
+        std::uint16_t usedRows;
+        std::uint8_t transposed;
+        std::uint8_t band;
+    };
+
+    // one way of producing the best rows so far: orientation, column permutation, rows taken
+    // and the digit labels handed out, in order of first appearance
+    struct State {
+        std::uint16_t perm;
+        std::uint16_t usedRows;
+        std::uint8_t transposed;
+        std::uint8_t band;
+        std::uint8_t nextLabel;
+        std::uint8_t labels[SIZE + 1];
+    };
+
+    // per orientation and row: the clue mask of each stack and the smallest image of the row
+    // under any column perm, a 9 bit clue pattern (bit 8 = first column). With no labels handed
+    // out yet a row's image is its pattern with the clues numbered 1, 2, ... so patterns order
+    // the same way rows do
+    struct RowShape {
+        std::uint8_t stackMask[3];
+        std::uint8_t sortedCounts[3];
+        int pattern;
+    };
+
+    RowShape shapeOf(const std::uint8_t* row) {
+        RowShape shape = {};
+        int counts[3];
+        for (int stack = 0; stack < 3; ++stack) {
+            int mask = 0;
+            for (int col = 0; col < 3; ++col) {
+                mask = mask << 1 | (row[3 * stack + col] != 0);
+            }
+            shape.stackMask[stack] = static_cast<std::uint8_t>(mask);
+            counts[stack] = (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1);
+        }
+        std::sort(counts, counts + 3);
+        for (int stack = 0; stack < 3; ++stack) {
+            shape.sortedCounts[stack] = static_cast<std::uint8_t>(counts[stack]);
+            shape.pattern = shape.pattern << 3 | ((1 << counts[stack]) - 1);
+        }
+        return shape;
+    }
+
+    bool allowed(int row, int level, std::uint16_t usedRows, int band) {
+        if (usedRows >> row & 1) {
+            return false;
+        }
+        // a new band may come from any band not used yet, otherwise the band continues
+        return level % 3 == 0 ? (usedRows >> (row / 3 * 3) & 7) == 0 : row / 3 == band;
+    }
+
+    // `state` extended by `row`, kept in `next` when its image is no larger than `best`.
+    // A smaller image replaces `best` and drops everything kept so far
+    void consider(const State& state, int row, const std::uint8_t* source, std::uint8_t* best, bool& haveBest, std::vector<State>& next) {
+        const std::uint8_t* columns = PERMS.columns[state.perm].data();
+        State candidate = state;
+        std::uint8_t line[SIZE];
+        int order = haveBest ? 0 : -1; // 0 equal so far, -1 already smaller
+        for (int col = 0; col < SIZE; ++col) {
+            const int value = source[row * SIZE + columns[col]];
+            if (value && !candidate.labels[value]) {
+                candidate.labels[value] = candidate.nextLabel++;
+            }
+            const std::uint8_t label = candidate.labels[value];
+            if (order == 0 && label != best[col]) {
+                if (label > best[col]) {
+                    return;
+                }
+                order = -1;
+            }
+            line[col] = label;
+        }
+        if (order < 0) {
+            std::memcpy(best, line, SIZE);
+            haveBest = true;
+            next.clear();
+        }
+        candidate.usedRows = static_cast<std::uint16_t>(state.usedRows | 1u << row);
+        candidate.band = static_cast<std::uint8_t>(row / 3);
+        next.push_back(candidate);
+    }
+
+    // offers every column perm giving the pattern of `row` its smallest image. With a digit
+    // repeated inside the row (not a valid puzzle) these images can still differ
+    void expandShape(const Prefix& prefix, int row, const RowShape& shape, const std::uint8_t* source,
+                     std::uint8_t* best, bool& haveBest, std::vector<State>& next) {
+        for (int stacks = 0; stacks < 6; ++stacks) {
+            int inside[3];
+            bool sorted = true;
+            for (int position = 0; position < 3; ++position) {
+                const int mask = shape.stackMask[ORDERS[stacks][position]];
+                const int clues = (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1);
+                sorted = sorted && clues == shape.sortedCounts[position];
+                inside[position] = ZEROS_FIRST.perms[mask];
+            }
+            if (!sorted) {
+                continue;
+            }
+            for (int firsts = inside[0]; firsts; firsts &= firsts - 1) {
+                const int first = __builtin_ctz(firsts);
+                for (int seconds = inside[1]; seconds; seconds &= seconds - 1) {
+                    const int second = __builtin_ctz(seconds);
+                    for (int thirds = inside[2]; thirds; thirds &= thirds - 1) {
+                        const int third = __builtin_ctz(thirds);
+                        State state = {};
+                        state.perm = static_cast<std::uint16_t>(((stacks * 6 + first) * 6 + second) * 6 + third);
+                        state.usedRows = prefix.usedRows;
+                        state.transposed = prefix.transposed;
+                        state.nextLabel = 1;
+                        consider(state, row, source, best, haveBest, next);
+                    }
+                }
+            }
+        }
+    }
+
+    std::uint64_t load64(const std::uint8_t* bytes) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+
+    std::uint64_t mix(std::uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ull;
+        x ^= x >> 33;
+        return x;
+    }
+}
+
+// Row by row branch and bound. Lexicographic order decides on the first row, so the search
+// keeps only the candidates whose rows so far equal the best prefix seen and drops a row at
+// the first cell where it comes out larger. Ties (from empty cells or symmetric puzzles) all
+// survive, so the result is the exact minimum. Up to the first row with a clue the column
+// perms are left implicit and only the perms giving that row its smallest image are listed
+void Canonical::form(const std::uint8_t* cells, std::uint8_t* canonical) {
+    std::uint8_t oriented[2][CELLS];
+    RowShape shapes[2][SIZE];
+    for (int index = 0; index < CELLS; ++index) {
+        oriented[0][index] = cells[index];
+        oriented[1][index] = cells[(index % SIZE) * SIZE + index / SIZE];
+    }
+    for (int transposed = 0; transposed < 2; ++transposed) {
+        for (int row = 0; row < SIZE; ++row) {
+            shapes[transposed][row] = shapeOf(oriented[transposed] + row * SIZE);
+        }
+    }
+
+    // per thread scratch that keeps its capacity between calls. Sized up front for the ties of
+    // any ordinary puzzle, only highly symmetric ones grow it further
+    thread_local std::vector<Prefix> prefixes;
+    thread_local std::vector<Prefix> nextPrefixes;
+    thread_local std::vector<State> current;
+    thread_local std::vector<State> next;
+    if (next.capacity() == 0) {
+        prefixes.reserve(1024);
+        nextPrefixes.reserve(1024);
+        current.reserve(1024);
+        next.reserve(1024);
+    }
+    prefixes.assign({{0, 0, 0}, {0, 1, 0}});
+    current.clear();
+    int level = 0;
+
+    for (; level < SIZE && current.empty(); ++level) {
+        int bestPattern = SIZE << 8;
+        for (const Prefix& prefix : prefixes) {
+            for (int row = 0; row < SIZE; ++row) {
+                if (allowed(row, level, prefix.usedRows, prefix.band)) {
+                    bestPattern = std::min(bestPattern, shapes[prefix.transposed][row].pattern);
+                }
+            }
+        }
+
+        std::uint8_t* best = canonical + level * SIZE;
+        bool haveBest = false;
+        nextPrefixes.clear();
+        for (const Prefix& prefix : prefixes) {
+            for (int row = 0; row < SIZE; ++row) {
+                const RowShape& shape = shapes[prefix.transposed][row];
+                if (!allowed(row, level, prefix.usedRows, prefix.band) || shape.pattern != bestPattern) {
+                    continue;
+                }
+                if (bestPattern == 0) {
+                    nextPrefixes.push_back({static_cast<std::uint16_t>(prefix.usedRows | 1u << row), prefix.transposed, static_cast<std::uint8_t>(row / 3)});
+                }
+                else {
+                    expandShape(prefix, row, shape, oriented[prefix.transposed], best, haveBest, current);
+                }
+            }
+        }
+        prefixes.swap(nextPrefixes);
+        if (bestPattern == 0) {
+            std::memset(best, 0, SIZE);
+        }
+    }
+
+    for (; level < SIZE; ++level) {
+        std::uint8_t* best = canonical + level * SIZE;
+        bool haveBest = false;
+        next.clear();
+
+        for (const State& state : current) {
+            for (int row = 0; row < SIZE; ++row) {
+                if (allowed(row, level, state.usedRows, state.band)) {
+                    consider(state, row, oriented[state.transposed], best, haveBest, next);
+                }
+            }
+        }
+        current.swap(next);
+    }
+}
+
+void Canonical::form(const Grid& grid, std::uint8_t* canonical) {
+    form(grid.getCells().data(), canonical);
+}
+
+Canonical::Hash Canonical::hash(const std::uint8_t* cells) {
+    std::uint8_t canonical[CELLS];
+    form(cells, canonical);
+    return hashForm(canonical);
+}
+
+Canonical::Hash Canonical::hash(const Grid& grid) {
+    return hash(grid.getCells().data());
+}
+
+// two independently seeded lanes over the 81 bytes, crossed at the end
+Canonical::Hash Canonical::hashForm(const std::uint8_t* canonical) {
+    std::uint64_t low = 0x9E3779B97F4A7C15ull;
+    std::uint64_t high = 0xD6E8FEB86659FD93ull;
+    int at = 0;
+    for (; at + 8 <= CELLS; at += 8) {
+        const std::uint64_t word = load64(canonical + at);
+        low = mix(low ^ word) + high;
+        high = mix(high + word) ^ low;
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, canonical + at, CELLS - at);
+    low = mix(low ^ tail ^ CELLS);
+    high = mix(high + tail + low);
+    return {low ^ (high >> 1), high};
+}
@@ -0,0 +1,211 @@
+#include "DancingLinks.hpp"
+
+DancingLinks::DancingLinks() : target(nullptr), limit(0), found(0) {
+    const int nodeCount = FIRST_ROW_NODE + ROW_COUNT * NODES_PER_ROW;
+    left.resize(nodeCount);
+    right.resize(nodeCount);
+    up.resize(nodeCount);
+    down.resize(nodeCount);
+    column.resize(nodeCount);
+    size.assign(COLUMN_COUNT + 1, 0);
+    covered.assign(COLUMN_COUNT + 1, 0);
+    hiddenRows.reserve(ROW_COUNT);
+    givenRows.reserve(Grid::CELL_COUNT);
+    choices.resize(Grid::CELL_COUNT);
+
+    for (int header = 0; header <= COLUMN_COUNT; ++header) {
+        left[header] = (header == 0) ? COLUMN_COUNT : header - 1;
+        right[header] = (header == COLUMN_COUNT) ? 0 : header + 1;
+        up[header] = down[header] = column[header] = header;
+    }
+
+    for (int row = 0; row < ROW_COUNT; ++row) {
+        const int cell = row / Grid::GRID_SIZE;
+        const int digit = row % Grid::GRID_SIZE;
+        const int r = cell / Grid::GRID_SIZE;
+        const int c = cell % Grid::GRID_SIZE;
+        const int headers[NODES_PER_ROW] = {
+            1 + cell,
+            1 + Grid::CELL_COUNT + r * Grid::GRID_SIZE + digit,
+            1 + 2 * Grid::CELL_COUNT + c * Grid::GRID_SIZE + digit,
+            1 + 3 * Grid::CELL_COUNT + Grid::getBoxIndex(r, c) * Grid::GRID_SIZE + digit
+        };
+
+        const int first = nodeOf(row);
+        for (int k = 0; k < NODES_PER_ROW; ++k) {
+            const int node = first + k;
+            const int header = headers[k];
+            left[node] = first + (k + NODES_PER_ROW - 1) % NODES_PER_ROW;
+            right[node] = first + (k + 1) % NODES_PER_ROW;
+            column[node] = header;
+            up[node] = up[header];
+            down[node] = header;
+            down[up[header]] = node;
+            up[header] = node;
+            ++size[header];
+        }
+    }
+}
+
+DancingLinks& DancingLinks::forThisThread() {
+    thread_local DancingLinks instance;
+    return instance;
+}
+
+int DancingLinks::solve(const Grid& grid, int solutionLimit, Grid* solution) {
+    found = 0;
+    limit = solutionLimit;
+    target = solution;
+
+    // rows ruled out by the grid's candidates never enter the search
+    for (int cell = 0; cell < Grid::CELL_COUNT; ++cell) {
+        if (grid.cellValue(cell) != Grid::EMPTY) {
+            continue;
+        }
+        const Grid::Mask allowed = grid.cellCandidates(cell);
+        for (int digit = 0; digit < Grid::GRID_SIZE; ++digit) {
+            if (!(allowed & (1u << digit))) {
+                const int row = cell * Grid::GRID_SIZE + digit;
+                hideRow(row);
+                hiddenRows.push_back(row);
+            }
+        }
+    }
+
+    bool consistent = true;
+    for (int cell = 0; cell < Grid::CELL_COUNT && consistent; ++cell) {
+        const int value = grid.cellValue(cell);
+        if (value != Grid::EMPTY) {
+            const int row = cell * Grid::GRID_SIZE + value - 1;
+            consistent = selectRow(row);
+            if (consistent) {
+                givenRows.push_back(row);
+            }
+        }
+    }
+
+    if (consistent && limit > 0) {
+        search(0);
+    }
+    restore();
+    return found;
+}
+
+void DancingLinks::cover(int col) {
+    covered[col] = 1;
+    right[left[col]] = right[col];
+    left[right[col]] = left[col];
+    for (int i = down[col]; i != col; i = down[i]) {
+        for (int j = right[i]; j != i; j = right[j]) {
+            up[down[j]] = up[j];
+            down[up[j]] = down[j];
+            --size[column[j]];
+        }
+    }
+}
+
+void DancingLinks::uncover(int col) {
+    for (int i = up[col]; i != col; i = up[i]) {
+        for (int j = left[i]; j != i; j = left[j]) {
+            ++size[column[j]];
+            up[down[j]] = j;
+            down[up[j]] = j;
+        }
+    }
+    right[left[col]] = col;
+    left[right[col]] = col;
+    covered[col] = 0;
+}
+
+void DancingLinks::hideRow(int row) {
+    const int first = nodeOf(row);
+    for (int node = first; node < first + NODES_PER_ROW; ++node) {
+        up[down[node]] = up[node];
+        down[up[node]] = down[node];
+        --size[column[node]];
+    }
+}
+
+void DancingLinks::unhideRow(int row) {
+    const int first = nodeOf(row);
+    for (int node = first + NODES_PER_ROW - 1; node >= first; --node) {
+        ++size[column[node]];
+        up[down[node]] = node;
+        down[up[node]] = node;
+    }
+}
+
+bool DancingLinks::selectRow(int row) {
+    const int first = nodeOf(row);
+    for (int node = first; node < first + NODES_PER_ROW; ++node) {
+        if (covered[column[node]]) {
+            return false;
+        }
+    }
+    for (int node = first; node < first + NODES_PER_ROW; ++node) {
+        cover(column[node]);
+    }
+    return true;
+}
+
+void DancingLinks::deselectRow(int row) {
+    const int first = nodeOf(row);
+    for (int node = first + NODES_PER_ROW - 1; node >= first; --node) {
+        uncover(column[node]);
+    }
+}
+
+void DancingLinks::search(int depth) {
+    if (right[ROOT] == ROOT) {
+        if (++found == 1 && target) {
+            // the givens too, the solution grid need not be the one being solved
+            for (const int row : givenRows) {
+                writeRow(row);
+            }
+            for (int i = 0; i < depth; ++i) {
+                writeRow((choices[i] - FIRST_ROW_NODE) / NODES_PER_ROW);
+            }
+        }
+        return;
+    }
+
+    // branch on the column with the fewest remaining rows
+    int best = right[ROOT];
+    for (int col = right[best]; col != ROOT && size[best] > 1; col = right[col]) {
+        if (size[col] < size[best]) {
+            best = col;
+        }
+    }
+    if (size[best] == 0) {
+        return;
+    }
+
+    cover(best);
+    for (int node = down[best]; node != best && found < limit; node = down[node]) {
+        choices[depth] = node;
+        for (int j = right[node]; j != node; j = right[j]) {
+            cover(column[j]);
+        }
+        search(depth + 1);
+        for (int j = left[node]; j != node; j = left[j]) {
+            uncover(column[j]);
+        }
+    }
+    uncover(best);
+}
+
+void DancingLinks::writeRow(int row) {
+    const int cell = row / Grid::GRID_SIZE;
+    target->set(cell / Grid::GRID_SIZE, cell % Grid::GRID_SIZE, row % Grid::GRID_SIZE + 1);
+}
+
+void DancingLinks::restore() {
+    while (!givenRows.empty()) {
+        deselectRow(givenRows.back());
+        givenRows.pop_back();
+    }
+    while (!hiddenRows.empty()) {
+        unhideRow(hiddenRows.back());
+        hiddenRows.pop_back();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "DedupIndex.hpp"
+#include "BatchIO.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t MIN_SLOTS = 16;
+
+    using Chunk = BatchIO::Chunk;
+
+    struct Line {
+        const char* text;
+        std::size_t length;
+        bool valid;
+        Canonical::Hash hash;
+    };
+
+    // hashes every puzzle line of the chunk, blank lines are dropped
+    void hashChunk(const Chunk& chunk, std::vector<Line>& lines) {
+        std::uint8_t cells[Grid::CELL_COUNT];
+        std::string_view line;
+        for (const char* next = chunk.begin; BatchIO::nextLine(next, chunk.end, line);) {
+            Line entry = {line.data(), line.size(), false, {0, 0}};
+            entry.valid = static_cast<bool>(Grid::parseCells(line, cells));
+            if (entry.valid) {
+                entry.hash = Canonical::hash(cells);
+            }
+            lines.push_back(entry);
+        }
+    }
+}
+
+DedupIndex::DedupIndex(std::size_t expected) : shards(new Shard[SHARD_COUNT]) {
+    std::size_t slots = MIN_SLOTS;
+    while (slots < 2 * expected / SHARD_COUNT) {
+        slots *= 2;
+    }
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        shards[i].slots.assign(slots, Canonical::Hash{0, 0});
+    }
+}
+
+bool DedupIndex::insert(const Canonical::Hash& hash) {
+    const Canonical::Hash entry = key(hash);
+    Shard& shard = shardFor(entry);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::size_t slot = find(shard, entry);
+    if (shard.slots[slot] == entry) {
+        return false;
+    }
+    // at most half full, so probes stay short
+    if (2 * (shard.used + 1) > shard.slots.size()) {
+        grow(shard);
+        slot = find(shard, entry);
+    }
+    shard.slots[slot] = entry;
+    ++shard.used;
+    return true;
+}
+
+bool DedupIndex::contains(const Canonical::Hash& hash) const {
+    const Canonical::Hash entry = key(hash);
+    const Shard& shard = shardFor(entry);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.slots[find(shard, entry)] == entry;
+}
+
+std::size_t DedupIndex::size() const {
+    std::size_t total = 0;
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        total += shards[i].used;
+    }
+    return total;
+}
+
+// Canonical forms, the expensive part, are computed a window of chunks at a time on the pool.
+// Lookups then run in input order on this thread, so the first of a set of equivalent puzzles
+// is the one kept, however the chunks were scheduled
+DedupIndex::Summary DedupIndex::filter(const std::string& inputPath, int outputFd, unsigned threads) {
+    const Clock::time_point start = Clock::now();
+    const MappedFile input(inputPath);
+    const std::vector<Chunk> chunks = BatchIO::split(input.data(), input.size(), 1 << 20);
+
+    ThreadPool pool(threads);
+    const std::size_t window = 4 * static_cast<std::size_t>(pool.size());
+    std::vector<std::vector<Line>> hashed(window);
+    std::string output;
+    Summary summary;
+
+    for (std::size_t first = 0; first < chunks.size(); first += window) {
+        const std::size_t last = std::min(chunks.size(), first + window);
+        for (std::size_t index = first; index < last; ++index) {
+            std::vector<Line>& lines = hashed[index - first];
+            lines.clear();
+            pool.submit([&chunk = chunks[index], &lines] { hashChunk(chunk, lines); });
+        }
+        pool.waitIdle();
+
+        for (std::size_t index = first; index < last; ++index) {
+            output.clear();
+            for (const Line& line : hashed[index - first]) {
+                if (!line.valid) {
+                    ++summary.skipped;
+                    continue;
+                }
+                ++summary.puzzles;
+                if (!insert(line.hash)) {
+                    ++summary.duplicates;
+                    continue;
+                }
+                output.append(line.text, line.length).push_back('\n');
+            }
+            BatchIO::writeAll(outputFd, output.data(), output.size(), "DedupIndex");
+        }
+    }
+
+    summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return summary;
+}
+
+Canonical::Hash DedupIndex::key(const Canonical::Hash& hash) {
+    return hash == Canonical::Hash{0, 0} ? Canonical::Hash{1, 0} : hash;
+}
+
+DedupIndex::Shard& DedupIndex::shardFor(const Canonical::Hash& key) const {
+    return shards[key.high >> (64 - SHARD_BITS)];
+}
+
+std::size_t DedupIndex::find(const Shard& shard, const Canonical::Hash& key) {
+    const std::size_t mask = shard.slots.size() - 1;
+    std::size_t slot = static_cast<std::size_t>(key.low) & mask;
+    while (shard.slots[slot] != key && shard.slots[slot] != Canonical::Hash{0, 0}) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void DedupIndex::grow(Shard& shard) {
+    std::vector<Canonical::Hash> old(2 * shard.slots.size(), Canonical::Hash{0, 0});
+    old.swap(shard.slots);
+    for (const Canonical::Hash& entry : old) {
+        if (entry != Canonical::Hash{0, 0}) {
+            shard.slots[find(shard, entry)] = entry;
+        }
+    }
+}
@@ -1,58 +1,249 @@
 #include "Game.hpp"
+#include "Solver.hpp"
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
 
-Game::Game(const Grid& grid) : grid(grid) {}
+namespace {
+    // session layout, integers little endian:
+    //   "SDKG", version byte
+    //   CELL_COUNT bytes   value, high bit set for a fixed cell
+    //   CELL_COUNT x u16   candidate masks
+    //   u32 journal size, u32 cursor
+    //   12 bytes per move  index, values, cellDelta u16, peersNew u32, peersOld u32
+    constexpr char SESSION_MAGIC[4] = {'S', 'D', 'K', 'G'};
+    constexpr std::uint8_t SESSION_VERSION = 1;
+    constexpr std::uint8_t FIXED_FLAG = 0x80;
+
+    template <typename T>
+    void writeLittle(std::ostream& out, T value) {
+        char bytes[sizeof(T)];
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            bytes[i] = static_cast<char>(value >> (8 * i));
+        }
+        out.write(bytes, sizeof(T));
+    }
+
+    template <typename T>
+    T readLittle(std::istream& in) {
+        unsigned char bytes[sizeof(T)];
+        if (!in.read(reinterpret_cast<char*>(bytes), sizeof(T))) {
+            throw std::runtime_error("Game::load - Session is truncated");
+        }
+        T value = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            value = static_cast<T>(value | static_cast<T>(bytes[i]) << (8 * i));
+        }
+        return value;
+    }
+}
+
+Game::Game(const Grid& grid)
+    : grid(grid), cursor(0), historyLimit(0), solutionState(SolutionState::Unknown) {
+    restartAnalysis();
+}
 
 // player actions
 bool Game::makeMove(int row, int col, int value) {
+    Move move;
+    if (!play(grid, row, col, value, move)) {
+        return false;
+    }
+    record(move);
+    follow(move, true);
+    return true;
+}
+
+void Game::undo() {
+    if (cursor > 0) {
+        --cursor;
+        replay(grid, journal[cursor], false);
+        follow(journal[cursor], false);
+    }
+}
+
+void Game::redo() {
+    if (cursor < journal.size()) {
+        replay(grid, journal[cursor], true);
+        follow(journal[cursor], true);
+        ++cursor;
+    }
+}
+
+void Game::reset(){
+    grid.reset();
+    clearHistory();
+    restartAnalysis();
+}
+
+bool Game::play(Grid& grid, int row, int col, int value, Move& move) {
      if (row < 0 || row >= Grid::GRID_SIZE || col < 0 || col >= Grid::GRID_SIZE) {
         return false;
     }
-    
+
     if (value < 1 || value > Grid::GRID_SIZE) {
         return false;
     }
 
     if (grid.getCellState(row, col) == CellState::Editable) {
-        Move move;
-        move.row = row;
-        move.col = col;
-        move.oldValue = grid.get(row, col);
-        move.oldCandidates = grid.getCandidates(row, col);
-        
+        const int index = row * Grid::GRID_SIZE + col;
+        const auto& peers = Grid::peersOf(index);
+        Grid::Mask peersBefore[Grid::PEER_COUNT];
+        for (int i = 0; i < Grid::PEER_COUNT; ++i) {
+            peersBefore[i] = grid.cellCandidates(peers[i]);
+        }
+        const Grid::Mask cellBefore = grid.cellCandidates(index);
+        const int oldValue = grid.cellValue(index);
+
         grid.set(row, col, value);
-        
-        move.newValue = value;
-        move.newCandidates = grid.getCandidates(row, col);
-        
-        undoStack.push(move);
+
+        move = {};
+        move.index = static_cast<std::uint8_t>(index);
+        move.values = static_cast<std::uint8_t>(oldValue << 4 | value);
+        move.cellDelta = cellBefore ^ grid.cellCandidates(index);
+        const Grid::Mask newBit = Grid::digitMask(value);
+        const Grid::Mask oldBit = oldValue != Grid::EMPTY ? Grid::digitMask(oldValue) : 0;
+        for (int i = 0; i < Grid::PEER_COUNT; ++i) {
+            const Grid::Mask changed = peersBefore[i] ^ grid.cellCandidates(peers[i]);
+            move.peersNew |= static_cast<std::uint32_t>((changed & newBit) != 0) << i;
+            move.peersOld |= static_cast<std::uint32_t>((changed & oldBit) != 0) << i;
+        }
         return true;
     }
     return false;
 }
 
-void Game::undo() {
-    if (!undoStack.empty()) {
-        const Move& lastMove = undoStack.top();
-        grid.set(lastMove.row, lastMove.col, lastMove.oldValue);
-        grid.setCandidates(lastMove.row, lastMove.col, lastMove.oldCandidates);
-        redoStack.push(lastMove);
-        undoStack.pop();
+// the value goes through Grid::set and the candidate deltas then put back exactly
+// the masks the move saw, pencil marks included
+void Game::replay(Grid& grid, const Move& move, bool forward) {
+    const int index = move.index;
+    const auto& peers = Grid::peersOf(index);
+    Grid::Mask peerMasks[Grid::PEER_COUNT];
+    for (int i = 0; i < Grid::PEER_COUNT; ++i) {
+        peerMasks[i] = grid.cellCandidates(peers[i]);
+    }
+    const Grid::Mask cellMask = grid.cellCandidates(index);
+
+    const int row = index / Grid::GRID_SIZE;
+    const int col = index % Grid::GRID_SIZE;
+    grid.set(row, col, forward ? move.newValue() : move.oldValue());
+    grid.setCandidateMask(row, col, cellMask ^ move.cellDelta);
+
+    const Grid::Mask newBit = Grid::digitMask(move.newValue());
+    const Grid::Mask oldBit = move.oldValue() != Grid::EMPTY ? Grid::digitMask(move.oldValue()) : 0;
+    for (int i = 0; i < Grid::PEER_COUNT; ++i) {
+        const Grid::Mask delta = (((move.peersNew >> i) & 1) ? newBit : 0) | (((move.peersOld >> i) & 1) ? oldBit : 0);
+        const Grid::Mask target = peerMasks[i] ^ delta;
+        if (grid.cellCandidates(peers[i]) != target) {
+            grid.setCandidateMask(peers[i] / Grid::GRID_SIZE, peers[i] % Grid::GRID_SIZE, target);
+        }
     }
 }
 
-void Game::redo() {
-    if (!redoStack.empty()) {
-        const Move& nextMove = redoStack.top();
-        grid.set(nextMove.row, nextMove.col, nextMove.newValue);
-        grid.setCandidates(nextMove.row, nextMove.col, nextMove.newCandidates);
-        undoStack.push(nextMove);
-        redoStack.pop();
+void Game::setHistoryLimit(std::size_t limit) {
+    historyLimit = limit;
+    // oldest undo steps go first, then the far end of the redo steps
+    while (historyLimit && journal.size() > historyLimit) {
+        if (cursor > 0) {
+            journal.pop_front();
+            --cursor;
+        }
+        else {
+            journal.pop_back();
+        }
     }
 }
 
-void Game::reset(){
-    grid.reset();
-    clearHistory();
+void Game::save(std::ostream& out) const {
+    out.write(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+    writeLittle<std::uint8_t>(out, SESSION_VERSION);
+    for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+        const bool fixed = grid.getCellState(index / Grid::GRID_SIZE, index % Grid::GRID_SIZE) == CellState::Fixed;
+        writeLittle<std::uint8_t>(out, static_cast<std::uint8_t>(grid.cellValue(index) | (fixed ? FIXED_FLAG : 0)));
+    }
+    for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+        writeLittle<std::uint16_t>(out, grid.cellCandidates(index));
+    }
+    writeLittle<std::uint32_t>(out, static_cast<std::uint32_t>(journal.size()));
+    writeLittle<std::uint32_t>(out, static_cast<std::uint32_t>(cursor));
+    for (const Move& move : journal) {
+        writeLittle<std::uint8_t>(out, move.index);
+        writeLittle<std::uint8_t>(out, move.values);
+        writeLittle<std::uint16_t>(out, move.cellDelta);
+        writeLittle<std::uint32_t>(out, move.peersNew);
+        writeLittle<std::uint32_t>(out, move.peersOld);
+    }
+}
+
+Game Game::load(std::istream& in) {
+    char magic[sizeof(SESSION_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), SESSION_MAGIC)) {
+        throw std::runtime_error("Game::load - Not a game session");
+    }
+    if (readLittle<std::uint8_t>(in) != SESSION_VERSION) {
+        throw std::runtime_error("Game::load - Unsupported session version");
+    }
+
+    std::uint8_t cells[Grid::CELL_COUNT];
+    std::uint8_t fixed[Grid::CELL_COUNT];
+    for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+        const std::uint8_t byte = readLittle<std::uint8_t>(in);
+        fixed[index] = byte & FIXED_FLAG;
+        if ((byte & ~FIXED_FLAG) > Grid::GRID_SIZE) {
+            throw std::runtime_error("Game::load - Bad value at cell " + std::to_string(index + 1));
+        }
+        cells[index] = static_cast<std::uint8_t>(byte & ~FIXED_FLAG);
+    }
+    Grid grid;
+    grid.loadFromCells(cells);
+    for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+        const int row = index / Grid::GRID_SIZE;
+        const int col = index % Grid::GRID_SIZE;
+        grid.setCellState(row, col, fixed[index] ? CellState::Fixed : CellState::Editable);
+        const std::uint16_t mask = readLittle<std::uint16_t>(in);
+        if (mask & ~Grid::ALL_MASK) {
+            throw std::runtime_error("Game::load - Bad candidates at cell " + std::to_string(index + 1));
+        }
+        grid.setCandidateMask(row, col, mask);
+    }
+
+    Game game(grid);
+    const std::uint32_t size = readLittle<std::uint32_t>(in);
+    const std::uint32_t cursor = readLittle<std::uint32_t>(in);
+    if (cursor > size) {
+        throw std::runtime_error("Game::load - Undo position past the end of the journal");
+    }
+    for (std::uint32_t i = 0; i < size; ++i) {
+        Move move;
+        move.index = readLittle<std::uint8_t>(in);
+        move.values = readLittle<std::uint8_t>(in);
+        move.cellDelta = readLittle<std::uint16_t>(in);
+        move.peersNew = readLittle<std::uint32_t>(in);
+        move.peersOld = readLittle<std::uint32_t>(in);
+        if (move.index >= Grid::CELL_COUNT || move.oldValue() > Grid::GRID_SIZE ||
+            move.newValue() < 1 || move.newValue() > Grid::GRID_SIZE || (move.cellDelta & ~Grid::ALL_MASK)) {
+            throw std::runtime_error("Game::load - Bad move " + std::to_string(i + 1));
+        }
+        game.journal.push_back(move);
+    }
+    game.cursor = cursor;
+    return game;
+}
+
+// The hint analysis is a second grid that takes every move the player makes and, on top,
+// every elimination already handed out as a hint. Each technique remembers which units it
+// has searched without result, moves and eliminations mark units dirty again, so a hint
+// only rescans what changed since the last one. PLACE, MISTAKE and SOLUTION hints stay
+// cached until the next move, an ELIMINATE hint is applied to the analysis at once so the
+// next call moves on to what it unlocks. Until the first hint moves cost nothing extra
+Hint Game::nextHint() {
+    if (!hintValid) {
+        cachedHint = analyze();
+        hintValid = cachedHint.kind != Hint::Kind::ELIMINATE;
+    }
+    return cachedHint;
 }
 
 // state checks
@@ -64,7 +255,139 @@ const Grid& Game::getGrid() const{
     return grid;
 }
 
+void Game::follow(const Move& move, bool forward) {
+    hintValid = false;
+    if (analysing) {
+        analysis.set(move.index / Grid::GRID_SIZE, move.index % Grid::GRID_SIZE, forward ? move.newValue() : move.oldValue());
+    }
+}
+
+Hint Game::analyze() {
+    Hint hint;
+    if (!knowSolution()) {
+        return hint;
+    }
+
+    // techniques assume the position is right, so wrong values come first
+    for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+        const int value = grid.cellValue(index);
+        if (value != Grid::EMPTY && value != solution.cellValue(index)) {
+            hint.kind = Hint::Kind::MISTAKE;
+            hint.row = index / Grid::GRID_SIZE;
+            hint.col = index % Grid::GRID_SIZE;
+            hint.digit = solution.cellValue(index);
+            return hint;
+        }
+    }
+    if (grid.filledCount() == Grid::CELL_COUNT) {
+        return hint;
+    }
+
+    if (!analysing) {
+        analysis = grid;
+        std::fill(std::begin(pending), std::end(pending), Grid::ALL_UNITS);
+        analysing = true;
+    }
+    if (const Grid::UnitSet dirty = analysis.takeDirtyUnits()) {
+        for (Grid::UnitSet& units : pending) {
+            units |= dirty;
+        }
+    }
+    for (int technique = 0; technique < SolverStats::TECHNIQUE_COUNT; ++technique) {
+        if (pending[technique] == 0) {
+            continue;
+        }
+        Grid scratch = analysis;
+        if (!Solver::applyTechnique(scratch, technique, pending[technique])) {
+            pending[technique] = 0;
+            continue;
+        }
+
+        // a full pass builds on its own deductions, so the hint comes from the first unit that
+        // yields one on its own. Within one unit only naked singles still chain, hence the check
+        for (Grid::UnitSet units = pending[technique]; units; units &= units - 1) {
+            const Grid::UnitSet unit = units & -units;
+            scratch = analysis;
+            if (!Solver::applyTechnique(scratch, technique, unit)) {
+                pending[technique] &= ~unit;
+                continue;
+            }
+
+            hint.technique = technique;
+            for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+                const int digit = scratch.cellValue(index);
+                if (digit != analysis.cellValue(index) &&
+                    (technique != 0 || analysis.cellCandidates(index) == Grid::digitMask(digit))) {
+                    hint.kind = Hint::Kind::PLACE;
+                    hint.row = index / Grid::GRID_SIZE;
+                    hint.col = index % Grid::GRID_SIZE;
+                    hint.digit = digit;
+                    return hint;
+                }
+            }
+            for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+                const Grid::Mask removed = analysis.cellCandidates(index) & ~scratch.cellCandidates(index);
+                if (removed) {
+                    hint.kind = Hint::Kind::ELIMINATE;
+                    hint.row = index / Grid::GRID_SIZE;
+                    hint.col = index % Grid::GRID_SIZE;
+                    hint.digit = Grid::lowestDigit(removed);
+                    hint.eliminated = removed;
+                    analysis.setCandidateMask(hint.row, hint.col, analysis.cellCandidates(index) & ~removed);
+                    return hint;
+                }
+            }
+        }
+    }
+
+    // past what the techniques can do, reveal the most constrained cell
+    int fewest = Grid::GRID_SIZE + 1;
+    for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+        const int count = Grid::countCandidates(analysis.cellCandidates(index));
+        if (grid.cellValue(index) == Grid::EMPTY && count < fewest) {
+            fewest = count;
+            hint.kind = Hint::Kind::SOLUTION;
+            hint.technique = -1;
+            hint.row = index / Grid::GRID_SIZE;
+            hint.col = index % Grid::GRID_SIZE;
+            hint.digit = solution.cellValue(index);
+        }
+    }
+    return hint;
+}
+
+void Game::restartAnalysis() {
+    analysing = false;
+    hintValid = false;
+}
+
+// the solution of the fixed cells alone, worked out on the first hint
+bool Game::knowSolution() {
+    if (solutionState == SolutionState::Unknown) {
+        Grid givens = grid;
+        givens.reset();
+        solutionState = SolutionState::Missing;
+        if (Solver::countSolutionsUpTo(givens, Solver::MAX_SOLUTIONS_NEEDED) == 1) {
+            solution = givens;
+            Solver::solve(solution, Solver::Strategy::DLX);
+            solutionState = SolutionState::Unique;
+        }
+    }
+    return solutionState == SolutionState::Unique;
+}
+
+// a new move drops whatever could still be redone
+void Game::record(const Move& move) {
+    journal.erase(journal.begin() + static_cast<std::ptrdiff_t>(cursor), journal.end());
+    journal.push_back(move);
+    ++cursor;
+    if (historyLimit && journal.size() > historyLimit) {
+        journal.pop_front();
+        --cursor;
+    }
+}
+
 void Game::clearHistory() {
-    undoStack = std::stack<Move>(); 
-    redoStack = std::stack<Move>();
+    journal.clear();
+    cursor = 0;
 }
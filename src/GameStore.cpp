@@ -0,0 +1,225 @@
+#include "GameStore.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+// one session: the grid plus a ring of the last HISTORY_LIMIT moves, a cache line multiple
+// so neighbouring sessions played on different threads do not share a line
+struct alignas(64) GameStore::Record {
+    SpinLock lock;
+    bool live = false;
+    bool referenced = false;   // used since the last sweep
+    std::uint8_t first = 0;    // ring slot of the oldest move
+    std::uint8_t count = 0;    // moves in the ring
+    std::uint8_t cursor = 0;   // moves [0, cursor) can be undone, [cursor, count) redone
+    std::uint32_t generation = 1;
+    Grid grid;
+    Move moves[HISTORY_LIMIT];
+
+    Move& at(int i) { return moves[(first + i) % HISTORY_LIMIT]; }
+
+    // same rules as the Game journal: a new move drops the redo tail, a full ring the oldest move
+    void push(const Move& move) {
+        count = cursor;
+        if (count == HISTORY_LIMIT) {
+            first = static_cast<std::uint8_t>((first + 1) % HISTORY_LIMIT);
+            --count;
+            --cursor;
+        }
+        at(count) = move;
+        ++count;
+        ++cursor;
+    }
+
+    // outstanding handles stop matching, generation 0 is skipped so no handle is ever 0
+    void retire() {
+        live = false;
+        generation = generation + 1 ? generation + 1 : 1;
+    }
+};
+
+void GameStore::SpinLock::lock() {
+    while (locked.exchange(true, std::memory_order_acquire)) {
+        for (int spins = 0; locked.load(std::memory_order_relaxed); ++spins) {
+            if (spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+GameStore::GameStore(std::size_t maxSessions)
+    : capacity(static_cast<std::uint32_t>(std::min<std::size_t>(maxSessions, MAX_CAPACITY))),
+      slabCount((std::size_t{capacity} + SLAB_SIZE - 1) >> SLAB_SHIFT),
+      slabs(new std::atomic<Record*>[slabCount]),
+      slotCount(0), live(0) {
+    for (std::size_t i = 0; i < slabCount; ++i) {
+        slabs[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+GameStore::~GameStore() {
+    for (std::size_t i = 0; i < slabCount; ++i) {
+        delete[] slabs[i].load(std::memory_order_relaxed);
+    }
+}
+
+GameStore::Handle GameStore::create(const Grid& puzzle) {
+    std::uint32_t slot;
+    {
+        std::lock_guard<std::mutex> lock(allocMutex);
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            slot = slotCount.load(std::memory_order_relaxed);
+            if (slot >= capacity) {
+                throw std::length_error("GameStore::create - Store is full");
+            }
+            if ((slot & (SLAB_SIZE - 1)) == 0) {
+                slabs[slot >> SLAB_SHIFT].store(new Record[SLAB_SIZE], std::memory_order_release);
+            }
+            slotCount.store(slot + 1, std::memory_order_release);
+        }
+    }
+
+    Record& record = slabs[slot >> SLAB_SHIFT].load(std::memory_order_acquire)[slot & (SLAB_SIZE - 1)];
+    std::uint32_t generation;
+    {
+        std::lock_guard<SpinLock> guard(record.lock);
+        record.live = true;
+        record.referenced = true;
+        record.first = record.count = record.cursor = 0;
+        record.grid = puzzle;
+        generation = record.generation;
+    }
+    live.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<Handle>(generation) << 32 | slot;
+}
+
+bool GameStore::destroy(Handle handle) {
+    const bool destroyed = withSession(handle, [](Record& record) {
+        record.retire();
+        return true;
+    });
+    if (destroyed) {
+        release(static_cast<std::uint32_t>(handle));
+    }
+    return destroyed;
+}
+
+bool GameStore::makeMove(Handle handle, int row, int col, int value) {
+    return withSession(handle, [&](Record& record) {
+        Move move;
+        if (!Game::play(record.grid, row, col, value, move)) {
+            return false;
+        }
+        record.push(move);
+        return true;
+    });
+}
+
+bool GameStore::undo(Handle handle) {
+    return withSession(handle, [](Record& record) {
+        if (record.cursor == 0) {
+            return false;
+        }
+        --record.cursor;
+        Game::replay(record.grid, record.at(record.cursor), false);
+        return true;
+    });
+}
+
+bool GameStore::redo(Handle handle) {
+    return withSession(handle, [](Record& record) {
+        if (record.cursor == record.count) {
+            return false;
+        }
+        Game::replay(record.grid, record.at(record.cursor), true);
+        ++record.cursor;
+        return true;
+    });
+}
+
+bool GameStore::isSolved(Handle handle) const {
+    return withSession(handle, [](Record& record) {
+        return record.grid.isComplete();
+    });
+}
+
+bool GameStore::snapshot(Handle handle, Grid& grid) const {
+    return withSession(handle, [&](Record& record) {
+        grid = record.grid;
+        return true;
+    });
+}
+
+// CLOCK style: a use sets `referenced`, a sweep clears it, and a session found clear
+// has sat through a whole interval untouched. A locked record is in use and skipped
+std::size_t GameStore::sweep() {
+    std::vector<std::uint32_t> evicted;
+    const std::uint32_t slots = slotCount.load(std::memory_order_acquire);
+    for (std::uint32_t slot = 0; slot < slots; ++slot) {
+        Record& record = slabs[slot >> SLAB_SHIFT].load(std::memory_order_acquire)[slot & (SLAB_SIZE - 1)];
+        if (!record.lock.tryLock()) {
+            continue;
+        }
+        if (record.live) {
+            if (record.referenced) {
+                record.referenced = false;
+            }
+            else {
+                record.retire();
+                evicted.push_back(slot);
+            }
+        }
+        record.lock.unlock();
+    }
+
+    if (!evicted.empty()) {
+        std::lock_guard<std::mutex> lock(allocMutex);
+        freeSlots.insert(freeSlots.end(), evicted.begin(), evicted.end());
+        live.fetch_sub(evicted.size(), std::memory_order_relaxed);
+    }
+    return evicted.size();
+}
+
+std::size_t GameStore::bytesPerSession() {
+    static_assert(sizeof(Record) <= 1024 - sizeof(std::uint32_t), "a session must stay under 1 KB");
+    return sizeof(Record) + sizeof(std::uint32_t); // record plus its free list entry
+}
+
+GameStore::Record* GameStore::find(Handle handle) const {
+    const std::uint32_t slot = static_cast<std::uint32_t>(handle);
+    if (slot >= slotCount.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &slabs[slot >> SLAB_SHIFT].load(std::memory_order_acquire)[slot & (SLAB_SIZE - 1)];
+}
+
+// runs `action` on the live session behind `handle` with its record locked
+template <typename Action>
+bool GameStore::withSession(Handle handle, Action&& action) const {
+    Record* record = find(handle);
+    if (!record) {
+        return false;
+    }
+    std::lock_guard<SpinLock> guard(record->lock);
+    if (!record->live || record->generation != static_cast<std::uint32_t>(handle >> 32)) {
+        return false;
+    }
+    record->referenced = true;
+    return action(*record);
+}
+
+void GameStore::release(std::uint32_t slot) {
+    std::lock_guard<std::mutex> lock(allocMutex);
+    freeSlots.push_back(slot);
+    live.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -1,16 +1,55 @@
 #include "Generator.hpp"
 #include "Solver.hpp"
+#include "DedupIndex.hpp"
 #include <algorithm>
+#include <array>
+#include <random>
+#include <stdexcept>
 
-Generator::Generator() : rng(std::random_device{}()) {}
+template <int BoxSize>
+BasicGenerator<BoxSize>::BasicGenerator() : BasicGenerator(static_cast<std::uint64_t>(std::random_device{}()) << 32 | std::random_device{}()) {}
 
-Grid Generator::generate(Difficulty difficulty) {
-    Grid grid;
-    Solver solver;
-    
-    fillDiagonal(grid);
-    solver.solve(grid, Solver::Strategy::BRUTE_FORCE);
-    removeNumbers(grid, difficulty);
+// one search per solution: generating the puzzle costs far more than the search, and every
+// solution then comes from a different base grid
+template <int BoxSize>
+BasicGenerator<BoxSize>::BasicGenerator(std::uint64_t seed)
+    : rng(seed), solutions(rng()), removalBatchSize(1), nodeBudget(DEFAULT_NODE_BUDGET), dedup(nullptr) {
+    solutions.setTransformsPerSearch(1);
+}
+
+template <int BoxSize>
+void BasicGenerator<BoxSize>::setDedupIndex(DedupIndex* index) {
+    if (index && BoxSize != 3) {
+        throw std::invalid_argument("Generator::setDedupIndex - Canonical forms exist for 9x9 boards only");
+    }
+    dedup = index;
+}
+
+template <int BoxSize>
+typename BasicGenerator<BoxSize>::Grid BasicGenerator<BoxSize>::generate(Difficulty difficulty) {
+    Grid solution;
+    return generate(difficulty, solution);
+}
+
+template <int BoxSize>
+typename BasicGenerator<BoxSize>::Grid BasicGenerator<BoxSize>::generate(Difficulty difficulty, Grid& solution) {
+    for (int duplicates = 0; duplicates < MAX_DUPLICATES; ++duplicates) {
+        Grid grid = generateOnce(difficulty, solution);
+        if constexpr (BoxSize == 3) {
+            if (dedup && !dedup->insert(Canonical::hash(grid))) {
+                continue;
+            }
+        }
+        return grid;
+    }
+    throw std::runtime_error("Generator::generate - " + std::to_string(MAX_DUPLICATES) + " duplicates in a row");
+}
+
+template <int BoxSize>
+typename BasicGenerator<BoxSize>::Grid BasicGenerator<BoxSize>::generateOnce(Difficulty difficulty, Grid& solution) {
+    Grid grid = solutions.next();
+    solution = grid;
+    removeNumbers(grid, solution, difficulty);
 
     for (int i = 0; i < Grid::GRID_SIZE; ++i) {
         for (int j = 0; j < Grid::GRID_SIZE; ++j) {
@@ -25,56 +64,67 @@ Grid Generator::generate(Difficulty difficulty) {
     return grid;
 }
 
-void Generator::fillDiagonal(Grid& grid) {
-    for (int box = 0; box < Grid::GRID_SIZE; box += Grid::SUBGRID_SIZE) {
-        std::array<int, Grid::SUBGRID_SIZE * Grid::SUBGRID_SIZE> nums;
-        std::iota(nums.begin(), nums.end(), 1);
-        std::shuffle(nums.begin(), nums.end(), rng);
+// The puzzle stays uniquely solvable (by `solution`) throughout, so after taking out a clue
+// the only possible new solutions are ones that put a different digit in that cell.
+// Checking for those is a single search that usually dies within a few nodes.
+template <int BoxSize>
+void BasicGenerator<BoxSize>::removeNumbers(Grid& grid, const Grid& solution, Difficulty difficulty) {
+    int targetClues = static_cast<int>(difficulty) * Grid::CELL_COUNT / 81;
+    int currentClues = countFilledCells(grid);
+    
+    std::array<int, Grid::CELL_COUNT> positions;
+    int total = 0;
+    for (int i = 0; i < Grid::CELL_COUNT; ++i) {
+        if (grid.cellValue(i) != Grid::EMPTY) {
+            positions[total++] = i;
+        }
+    }
+    
+    std::shuffle(positions.begin(), positions.begin() + total, rng);
+    
+    for (int next = 0; next < total && currentClues > targetClues;) {
+        const int count = std::min({removalBatchSize, currentClues - targetClues, total - next});
+        if (count > 1 && removeGroup(grid, solution, &positions[next], count)) {
+            currentClues -= count;
+            next += count;
+            continue;
+        }
         
-        int index = 0;
-        for (int i = 0; i < Grid::SUBGRID_SIZE; ++i) {
-            for (int j = 0; j < Grid::SUBGRID_SIZE; ++j) {
-                grid.set(box + i, box + j, nums[index++]);
+        for (const int end = next + count; next < end && currentClues > targetClues; ++next) {
+            if (removeGroup(grid, solution, &positions[next], 1)) {
+                --currentClues;
             }
         }
     }
 }
 
-void Generator::removeNumbers(Grid& grid, Difficulty difficulty) {
-    int targetClues = static_cast<int>(difficulty);
-    int currentClues = countFilledCells(grid);
-    
-    std::vector<std::pair<int, int>> positions;
-    for (int i = 0; i < Grid::GRID_SIZE; ++i) {
-        for (int j = 0; j < Grid::GRID_SIZE; ++j) {
-            if (grid.get(i, j) != Grid::EMPTY) {
-                positions.emplace_back(i, j);
-            }
-        }
+// takes the clues out and keeps them out if the solution is still unique, otherwise puts them back
+template <int BoxSize>
+bool BasicGenerator<BoxSize>::removeGroup(Grid& grid, const Grid& solution, const int* cells, int count) {
+    for (int i = 0; i < count; ++i) {
+        grid.set(cells[i] / Grid::GRID_SIZE, cells[i] % Grid::GRID_SIZE, Grid::EMPTY);
     }
     
-    std::shuffle(positions.begin(), positions.end(), rng);
+    bool unique;
+    if (count == 1) {
+        const int row = cells[0] / Grid::GRID_SIZE;
+        const int col = cells[0] % Grid::GRID_SIZE;
+        unique = !Solver::hasSolutionWithout(grid, row, col, solution.get(row, col), nodeBudget);
+    }
+    else {
+        unique = Solver::countSolutionsWithin(grid, Solver::MAX_SOLUTIONS_NEEDED, nodeBudget) == 1;
+    }
     
-    for (const auto& [row, col] : positions) {
-        if (currentClues <= targetClues) {
-            break;
-        }
-        
-        int savedValue = grid.get(row, col);
-        grid.set(row, col, Grid::EMPTY);
-        
-        Grid temp = grid;
-        if (Solver::hasUniqueSolution(temp)) {
-            --currentClues;
-        } 
-        else {
-            grid.set(row, col, savedValue);
-            grid.updateCandidatesForCell(row, col);
+    if (!unique) {
+        for (int i = 0; i < count; ++i) {
+            grid.set(cells[i] / Grid::GRID_SIZE, cells[i] % Grid::GRID_SIZE, solution.cellValue(cells[i]));
         }
     }
+    return unique;
 }
 
-int Generator::countFilledCells(const Grid& grid) const {
+template <int BoxSize>
+int BasicGenerator<BoxSize>::countFilledCells(const Grid& grid) const {
     int count = 0;
     for (int i = 0; i < Grid::GRID_SIZE; ++i) {
         for (int j = 0; j < Grid::GRID_SIZE; ++j) {
@@ -84,4 +134,8 @@ int Generator::countFilledCells(const Grid& grid) const {
         }
     }
     return count;
-}
\ No newline at end of file
+}
+
+template class BasicGenerator<3>;
+template class BasicGenerator<4>;
+template class BasicGenerator<5>;
@@ -1,58 +1,194 @@
 #include "Grid.hpp"
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const char* parseStatusName(ParseStatus status) {
+    switch (status) {
+        case ParseStatus::Ok: return "ok";
+        case ParseStatus::BadCharacter: return "bad character";
+        case ParseStatus::TooFewCells: return "too few cells";
+        case ParseStatus::TooManyCells: return "too many cells";
+    }
+    return "unknown";
+}
 
-const std::set<int> Grid::ALL_CANDIDATES = {1,2,3,4,5,6,7,8,9}; 
+namespace {
+    template <int BoxSize>
+    using PeerTable = std::array<std::array<typename BasicGrid<BoxSize>::Index, BasicGrid<BoxSize>::PEER_COUNT>,
+                                 BasicGrid<BoxSize>::CELL_COUNT>;
+
+    // row peers, then column peers, then the rest of the box
+    template <int BoxSize>
+    constexpr PeerTable<BoxSize> buildPeerTable() {
+        using G = BasicGrid<BoxSize>;
+        PeerTable<BoxSize> table = {};
+        for (int index = 0; index < G::CELL_COUNT; ++index) {
+            const int row = index / G::GRID_SIZE;
+            const int col = index % G::GRID_SIZE;
+            const int boxRow = row - row % G::SUBGRID_SIZE;
+            const int boxCol = col - col % G::SUBGRID_SIZE;
+            int count = 0;
+            for (int k = 0; k < G::GRID_SIZE; ++k) {
+                if (k != col) {
+                    table[index][count++] = static_cast<typename G::Index>(row * G::GRID_SIZE + k);
+                }
+            }
+            for (int k = 0; k < G::GRID_SIZE; ++k) {
+                if (k != row) {
+                    table[index][count++] = static_cast<typename G::Index>(k * G::GRID_SIZE + col);
+                }
+            }
+            for (int r = boxRow; r < boxRow + G::SUBGRID_SIZE; ++r) {
+                for (int c = boxCol; c < boxCol + G::SUBGRID_SIZE; ++c) {
+                    if (r != row && c != col) {
+                        table[index][count++] = static_cast<typename G::Index>(r * G::GRID_SIZE + c);
+                    }
+                }
+            }
+        }
+        return table;
+    }
 
-Grid::Grid() {
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            cells[row][col] = EMPTY;
-            cellStates[row][col] = CellState::Editable;
-            candidates[row][col] = ALL_CANDIDATES;
+    template <int BoxSize>
+    using UnitTable = std::array<std::array<typename BasicGrid<BoxSize>::Index, BasicGrid<BoxSize>::GRID_SIZE>,
+                                 BasicGrid<BoxSize>::UNIT_COUNT>;
+
+    template <int BoxSize>
+    constexpr UnitTable<BoxSize> buildUnitTable() {
+        using G = BasicGrid<BoxSize>;
+        UnitTable<BoxSize> table = {};
+        for (int i = 0; i < G::GRID_SIZE; ++i) {
+            for (int j = 0; j < G::GRID_SIZE; ++j) {
+                const int boxRow = (i / G::SUBGRID_SIZE) * G::SUBGRID_SIZE + j / G::SUBGRID_SIZE;
+                const int boxCol = (i % G::SUBGRID_SIZE) * G::SUBGRID_SIZE + j % G::SUBGRID_SIZE;
+                table[i][j] = static_cast<typename G::Index>(i * G::GRID_SIZE + j);
+                table[G::GRID_SIZE + i][j] = static_cast<typename G::Index>(j * G::GRID_SIZE + i);
+                table[2 * G::GRID_SIZE + i][j] = static_cast<typename G::Index>(boxRow * G::GRID_SIZE + boxCol);
+            }
         }
+        return table;
     }
+
+    template <int BoxSize>
+    using CellUnitTable = std::array<typename BasicGrid<BoxSize>::UnitSet, BasicGrid<BoxSize>::CELL_COUNT>;
+
+    template <int BoxSize>
+    constexpr CellUnitTable<BoxSize> buildCellUnitTable() {
+        using G = BasicGrid<BoxSize>;
+        using UnitSet = typename G::UnitSet;
+        CellUnitTable<BoxSize> table = {};
+        for (int index = 0; index < G::CELL_COUNT; ++index) {
+            const int row = index / G::GRID_SIZE;
+            const int col = index % G::GRID_SIZE;
+            table[index] = (UnitSet(1) << row) | (UnitSet(1) << (G::GRID_SIZE + col)) |
+                           (UnitSet(1) << (2 * G::GRID_SIZE + G::getBoxIndex(row, col)));
+        }
+        return table;
+    }
+
+    // built at compile time, once per board size
+    template <int BoxSize> constexpr PeerTable<BoxSize> PEERS = buildPeerTable<BoxSize>();
+    template <int BoxSize> constexpr UnitTable<BoxSize> UNITS = buildUnitTable<BoxSize>();
+    template <int BoxSize> constexpr CellUnitTable<BoxSize> CELL_UNITS = buildCellUnitTable<BoxSize>(); // the three units holding a cell
 }
 
-int Grid::get(int row, int col) const {
+template <int BoxSize>
+const std::set<int> BasicGrid<BoxSize>::ALL_CANDIDATES = [] {
+    std::set<int> all;
+    for (int digit = 1; digit <= GRID_SIZE; ++digit) {
+        all.insert(digit);
+    }
+    return all;
+}();
+
+template <int BoxSize>
+BasicGrid<BoxSize>::BasicGrid() {
+    cells.fill(EMPTY);
+    cellStates.fill(CellState::Editable);
+    candidates.fill(ALL_MASK);
+    rowUsed.fill(0);
+    colUsed.fill(0);
+    boxUsed.fill(0);
+    filled = 0;
+    dirtyUnits = ALL_UNITS;
+}
+
+template <int BoxSize>
+int BasicGrid<BoxSize>::get(int row, int col) const {
     if (row < 0 || row >= GRID_SIZE || col < 0 || col >= GRID_SIZE) {
         throw std::out_of_range("Grid::get - Row or column index out of bounds");
     }
-    return cells[row][col];
+    return cells[row * GRID_SIZE + col];
 }
 
-void Grid::set(int row, int col, int val) {
+template <int BoxSize>
+void BasicGrid<BoxSize>::set(int row, int col, int val) {
     if (row < 0 || row >= GRID_SIZE || col < 0 || col >= GRID_SIZE) {
         throw std::out_of_range("Grid::set - Row or column index out of bounds");
     }
     if (val < 0 || val > GRID_SIZE) {
-        throw std::invalid_argument("Grid::set - Value must be between 0 and 9");
+        throw std::invalid_argument("Grid::set - Value must be between 0 and " + std::to_string(GRID_SIZE));
     }
-    if (cellStates[row][col] == CellState::Editable) {
-        cells[row][col] = val;
+    const int index = row * GRID_SIZE + col;
+    if (cellStates[index] == CellState::Editable && cells[index] != val) {
+        if (cells[index] != EMPTY) {
+            removeDigit(index);
+        }
         if (val != EMPTY) {
-            candidates[row][col].clear(); 
-        } 
-        else {
-            candidates[row][col] = ALL_CANDIDATES;  
+            placeDigit(index, val);
         }
-        updateAllCandidates(); 
     }
 }
 
-void Grid::reset() {
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            if (cellStates[row][col] == CellState::Editable) {
-                cells[row][col] = EMPTY;
-                candidates[row][col] = ALL_CANDIDATES;
-            }
+template <int BoxSize>
+void BasicGrid<BoxSize>::reset() {
+    for (int index = 0; index < CELL_COUNT; ++index) {
+        if (cellStates[index] == CellState::Editable) {
+            cells[index] = EMPTY;
+        }
+    }
+    updateAllCandidates();
+}
+
+// one pass instead of a set() per cell for callers that already hold the whole solution
+template <int BoxSize>
+void BasicGrid<BoxSize>::completeWith(const std::uint8_t* values) {
+    for (int index = 0; index < CELL_COUNT; ++index) {
+        if (cellStates[index] == CellState::Editable && cells[index] == EMPTY) {
+            cells[index] = values[index];
         }
     }
     updateAllCandidates();
 }
 
-void Grid::loadFromStrings(const std::vector<std::string>& input) {
+template <int BoxSize>
+void BasicGrid<BoxSize>::completeWithSolution(const std::uint8_t* solution) {
+    // branch free, the empty cells of a puzzle follow no pattern a predictor could learn
+    int empty = 0;
+    for (int index = 0; index < CELL_COUNT; ++index) {
+        const int open = (cells[index] == EMPTY) & (cellStates[index] == CellState::Editable);
+        cells[index] = static_cast<std::uint8_t>(cells[index] | solution[index] * open);
+        empty += cells[index] == EMPTY;
+    }
+    if (empty > 0) {
+        updateAllCandidates();
+        return;
+    }
+    candidates.fill(0);
+    rowUsed.fill(ALL_MASK);
+    colUsed.fill(ALL_MASK);
+    boxUsed.fill(ALL_MASK);
+    filled = CELL_COUNT;
+    dirtyUnits = ALL_UNITS;
+}
+
+template <int BoxSize>
+void BasicGrid<BoxSize>::loadFromStrings(const std::vector<std::string>& input) {
     if (input.size() != GRID_SIZE) {
-        throw std::invalid_argument("Grid::loadFromStrings - Input must have exactly 9 lines");
+        throw std::invalid_argument("Grid::loadFromStrings - Input must have exactly " + std::to_string(GRID_SIZE) + " lines");
     }
 
     for (int row = 0; row < GRID_SIZE; ++row) {
@@ -60,7 +196,7 @@ void Grid::loadFromStrings(const std::vector<std::string>& input) {
 
         if (line.length() != GRID_SIZE) {
             throw std::invalid_argument(
-                "Grid::loadFromStrings - Each line must have exactly 9 characters. "
+                "Grid::loadFromStrings - Each line must have exactly " + std::to_string(GRID_SIZE) + " characters. "
                 "Line " + std::to_string(row + 1) + " has " + 
                 std::to_string(line.length()) + " characters"
             );
@@ -68,23 +204,116 @@ void Grid::loadFromStrings(const std::vector<std::string>& input) {
 
         for (int col = 0; col < GRID_SIZE; ++col) {
             char c = line[col];
-            if (c < '0' || c > '9') {
+            int val = digitFromChar(c);
+            if (val < 0) {
                 throw std::invalid_argument(
-                    "Grid::loadFromStrings - All characters must be digits 0-9. "
+                    "Grid::loadFromStrings - All characters must be digits 0-" + std::string(1, charFromDigit(GRID_SIZE)) + ". "
                     "Found '" + std::string(1, c) + "' at row " + 
                     std::to_string(row + 1) + ", column " + std::to_string(col + 1)
                 );
             }
-            int val = c - '0';
-            cells[row][col] = val;
-            cellStates[row][col] = (val != 0) ? CellState::Fixed : CellState::Editable;
+            cells[row * GRID_SIZE + col] = static_cast<std::uint8_t>(val);
+            cellStates[row * GRID_SIZE + col] = (val != 0) ? CellState::Fixed : CellState::Editable;
+        }
+    }
+    updateAllCandidates();
+}
+
+template <int BoxSize>
+void BasicGrid<BoxSize>::loadFromLine(const char* line, std::size_t length) {
+    if (length != CELL_COUNT) {
+        throw std::invalid_argument(
+            "Grid::loadFromLine - Line must have exactly " + std::to_string(CELL_COUNT) +
+            " characters, got " + std::to_string(length)
+        );
+    }
+
+    std::uint8_t values[CELL_COUNT];
+    const int bad = readLine(line, values);
+    if (bad >= 0) {
+        throw std::invalid_argument(
+            "Grid::loadFromLine - Unexpected character '" + std::string(1, line[bad]) +
+            "' at position " + std::to_string(bad + 1)
+        );
+    }
+    loadFromCells(values);
+}
+
+template <int BoxSize>
+void BasicGrid<BoxSize>::loadFromCells(const std::uint8_t* values) {
+    for (int index = 0; index < CELL_COUNT; ++index) {
+        if (values[index] > GRID_SIZE) {
+            throw std::invalid_argument(
+                "Grid::loadFromCells - Value " + std::to_string(values[index]) +
+                " at position " + std::to_string(index + 1) + " is not a digit of this board"
+            );
+        }
+    }
+    // validated first, so a throw leaves the grid as it was
+    for (int index = 0; index < CELL_COUNT; ++index) {
+        cells[index] = values[index];
+        cellStates[index] = (cells[index] != EMPTY) ? CellState::Fixed : CellState::Editable;
+    }
+    updateAllCandidates();
+}
+
+template <int BoxSize>
+ParseResult BasicGrid<BoxSize>::parse(std::string_view text) {
+    std::uint8_t values[CELL_COUNT];
+    const ParseResult result = parseCells(text, values);
+    if (result) {
+        loadFromCells(values);
+    }
+    return result;
+}
+
+// values are only complete when the result is Ok
+template <int BoxSize>
+ParseResult BasicGrid<BoxSize>::parseCells(std::string_view text, std::uint8_t* values) {
+    // the common case first: a single line of cells, possibly with its line break
+    std::size_t length = text.size();
+    while (length > CELL_COUNT && (text[length - 1] == '\n' || text[length - 1] == '\r')) {
+        --length;
+    }
+    if (length == CELL_COUNT && readLine(text.data(), values) < 0) {
+        return {ParseStatus::Ok, text.size(), CELL_COUNT};
+    }
+
+    int count = 0;
+    bool lineStart = true;
+    for (std::size_t at = 0; at < text.size(); ++at) {
+        const char c = text[at];
+        if (lineStart && (c == '#' || c == '[')) {
+            at = text.find('\n', at);
+            if (at == std::string_view::npos) {
+                break;
+            }
+            continue;
         }
+        lineStart = c == '\n';
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '|' || c == '-' || c == '+') {
+            continue;
+        }
+        const int val = digitFromChar(c);
+        if (val < 0) {
+            return {ParseStatus::BadCharacter, at, count};
+        }
+        if (count == CELL_COUNT) {
+            return {ParseStatus::TooManyCells, at, count};
+        }
+        values[count++] = static_cast<std::uint8_t>(val);
+    }
+    if (count < CELL_COUNT) {
+        return {ParseStatus::TooFewCells, text.size(), count};
     }
+    return {ParseStatus::Ok, text.size(), count};
 }
 
-std::vector<std::string> Grid::readPuzzleFromConsole() {
+template <int BoxSize>
+std::vector<std::string> BasicGrid<BoxSize>::readPuzzleFromConsole() {
     std::vector<std::string> puzzle;
-    std::cout << "Enter the Sudoku puzzle (9 lines of 9 digits each, use 0 for empty cells):\n";
+    std::cout << "Enter the Sudoku puzzle (" << GRID_SIZE << " lines of " << GRID_SIZE
+              << " digits each, use 0 or . for empty cells):\n";
     
     for (int i = 0; i < GRID_SIZE; ++i) {
         std::string line;
@@ -95,20 +324,20 @@ std::vector<std::string> Grid::readPuzzleFromConsole() {
             line.erase(std::remove_if(line.begin(), line.end(), ::isspace), line.end());
             
             if (line.length() != GRID_SIZE) {
-                std::cout << "Error: Each line must have exactly 9 digits. Try again.\n";
+                std::cout << "Error: Each line must have exactly " << GRID_SIZE << " digits. Try again.\n";
                 continue;
             }
             
             bool valid = true;
             for (char c : line) {
-                if (c < '0' || c > '9') {
+                if (digitFromChar(c) < 0) {
                     valid = false;
                     break;
                 }
             }
             
             if (!valid) {
-                std::cout << "Error: Only digits 0-9 are allowed. Try again.\n";
+                std::cout << "Error: Only digits 0-" << charFromDigit(GRID_SIZE) << " and . are allowed. Try again.\n";
                 continue;
             }
             
@@ -119,131 +348,202 @@ std::vector<std::string> Grid::readPuzzleFromConsole() {
     return puzzle;
 }
 
-CellState Grid::getCellState(int row, int col) const {
-    return cellStates[row][col];
+template <int BoxSize>
+CellState BasicGrid<BoxSize>::getCellState(int row, int col) const {
+    return cellStates[row * GRID_SIZE + col];
 }
 
-void Grid::setCellState(int row, int col, CellState state) {
-    cellStates[row][col] = state;
+template <int BoxSize>
+void BasicGrid<BoxSize>::setCellState(int row, int col, CellState state) {
+    cellStates[row * GRID_SIZE + col] = state;
 }
 
-const std::set<int>& Grid::getCandidates(int row, int col) const {
+template <int BoxSize>
+std::set<int> BasicGrid<BoxSize>::getCandidates(int row, int col) const {
     if (row < 0 || row >= GRID_SIZE || col < 0 || col >= GRID_SIZE) {
         throw std::out_of_range("Grid::getCandidates - Row or column index out of bounds");
     }
-    return candidates[row][col];
+    std::set<int> result;
+    for (Mask mask = candidates[row * GRID_SIZE + col]; mask; mask &= mask - 1) {
+        result.insert(lowestDigit(mask));
+    }
+    return result;
 }
 
-void Grid::updateCandidatesForCell(int row, int col) {
-    if (cells[row][col] != EMPTY) {
-        candidates[row][col].clear();
-        return;
-    }
+template <int BoxSize>
+void BasicGrid<BoxSize>::updateCandidatesForCell(int row, int col) {
+    const int index = row * GRID_SIZE + col;
+    candidates[index] = (cells[index] != EMPTY) ? 0 : ALL_MASK & ~usedMaskFor(index);
+}
 
-    std::set<int> possible = ALL_CANDIDATES;
+template <int BoxSize>
+void BasicGrid<BoxSize>::setCandidates(int row, int col, const std::set<int>& newCandidates) {
+    Mask mask = 0;
+    for (int digit : newCandidates) {
+        if (digit >= 1 && digit <= GRID_SIZE) {
+            mask |= digitMask(digit);
+        }
+    }
+    setCandidateMask(row, col, mask);
+}
 
-    for (int c = 0; c < GRID_SIZE; ++c) {
-        possible.erase(cells[row][c]);
+template <int BoxSize>
+void BasicGrid<BoxSize>::setCandidateMask(int row, int col, Mask mask) {
+    if (row >= 0 && row < GRID_SIZE && col >= 0 && col < GRID_SIZE) {
+        const int index = row * GRID_SIZE + col;
+        if (candidates[index] != (mask & ALL_MASK)) {
+            candidates[index] = mask & ALL_MASK;
+            markDirty(index);
+        }
     }
+}
+
+template <int BoxSize>
+void BasicGrid<BoxSize>::clearCellCandidates(int row, int col) {
+    candidates[row * GRID_SIZE + col] = 0;
+    markDirty(row * GRID_SIZE + col);
+}
+
+template <int BoxSize>
+void BasicGrid<BoxSize>::clearCandidates() {
+    candidates.fill(0);
+    dirtyUnits = ALL_UNITS;
+}
 
-    for (int r = 0; r < GRID_SIZE; ++r) {
-        possible.erase(cells[r][col]);
+template <int BoxSize>
+void BasicGrid<BoxSize>::toggleCandidate(int row, int col, int digit) {
+    if (row < 0 || row >= GRID_SIZE || col < 0 || col >= GRID_SIZE) {
+        throw std::out_of_range("Grid::toggleCandidate - Row or column index out of bounds");
     }
 
-    int boxStartRow = (row / SUBGRID_SIZE) * SUBGRID_SIZE;
-    int boxStartCol = (col / SUBGRID_SIZE) * SUBGRID_SIZE;
+    if (digit < 1 || digit > GRID_SIZE) {
+        throw std::invalid_argument("Grid::toggleCandidate - Digit must be between 1 and " + std::to_string(GRID_SIZE));
+    }
 
-    for (int r = 0; r < SUBGRID_SIZE; ++r) {
-        for (int c = 0; c < SUBGRID_SIZE; ++c) {
-            possible.erase(cells[boxStartRow + r][boxStartCol + c]);
-        }
+    const int index = row * GRID_SIZE + col;
+    if (cells[index] != EMPTY) {
+        return;
     }
 
-    candidates[row][col] = std::move(possible);
+    candidates[index] ^= digitMask(digit);
+    markDirty(index);
 }
 
-void Grid::setCandidates(int row, int col, const std::set<int>& newCandidates) {
-    if (row >= 0 && row < GRID_SIZE && col >= 0 && col < GRID_SIZE) {
-        candidates[row][col] = newCandidates;
+template <int BoxSize>
+void BasicGrid<BoxSize>::place(int index, int digit, Trail& trail) {
+    const int row = index / GRID_SIZE;
+    const int col = index % GRID_SIZE;
+    const Mask bit = digitMask(digit);
+
+    trail.entries.push_back({static_cast<typename Trail::Slot>(index), cells[index], candidates[index]});
+    trail.entries.push_back({static_cast<typename Trail::Slot>(CELL_COUNT + row), 0, rowUsed[row]});
+    trail.entries.push_back({static_cast<typename Trail::Slot>(CELL_COUNT + GRID_SIZE + col), 0, colUsed[col]});
+    trail.entries.push_back({static_cast<typename Trail::Slot>(CELL_COUNT + 2 * GRID_SIZE + getBoxIndex(row, col)), 0,
+                             boxUsed[getBoxIndex(row, col)]});
+
+    cells[index] = static_cast<std::uint8_t>(digit);
+    candidates[index] = 0;
+    rowUsed[row] |= bit;
+    colUsed[col] |= bit;
+    boxUsed[getBoxIndex(row, col)] |= bit;
+    ++filled;
+
+    for (const Index peer : PEERS<BoxSize>[index]) {
+        if (candidates[peer] & bit) {
+            trail.entries.push_back({peer, cells[peer], candidates[peer]});
+            candidates[peer] &= static_cast<Mask>(~bit);
+        }
     }
 }
 
-void Grid::clearCellCandidates(int row, int col) {
-    candidates[row][col].clear();
+template <int BoxSize>
+bool BasicGrid<BoxSize>::eliminate(int index, Mask mask, Trail& trail) {
+    if (!(candidates[index] & mask)) {
+        return false;
+    }
+    trail.entries.push_back({static_cast<typename Trail::Slot>(index), cells[index], candidates[index]});
+    candidates[index] &= static_cast<Mask>(~mask);
+    return true;
 }
 
-void Grid::clearCandidates() {
-    for (int r = 0; r < GRID_SIZE; ++r) {
-        for (int c = 0; c < GRID_SIZE; ++c) {
-            candidates[r][c].clear();
+template <int BoxSize>
+void BasicGrid<BoxSize>::rollback(Trail& trail, std::size_t mark) {
+    while (trail.entries.size() > mark) {
+        const typename Trail::Entry& entry = trail.entries.back();
+        if (entry.slot < CELL_COUNT) {
+            filled += (entry.value != EMPTY) - (cells[entry.slot] != EMPTY);
+            cells[entry.slot] = entry.value;
+            candidates[entry.slot] = entry.mask;
         }
+        else {
+            unitMask(entry.slot - CELL_COUNT) = entry.mask;
+        }
+        trail.entries.pop_back();
     }
 }
 
-void Grid::toggleCandidate(int row, int col, int digit) {
-    if (row < 0 || row >= GRID_SIZE || col < 0 || col >= GRID_SIZE) {
-        throw std::out_of_range("Grid::toggleCandidate - Row or column index out of bounds");
-    }
+template <int BoxSize>
+const std::array<typename BasicGrid<BoxSize>::Index, BasicGrid<BoxSize>::PEER_COUNT>& BasicGrid<BoxSize>::peersOf(int index) {
+    return PEERS<BoxSize>[index];
+}
 
-    if (digit < 0 || digit > GRID_SIZE) {
-        throw std::invalid_argument("Grid::toggleCandidate - Digit must be between 0 and 9");
+template <int BoxSize>
+typename BasicGrid<BoxSize>::Mask BasicGrid<BoxSize>::getUnitMask(int unit) const {
+    if (unit < GRID_SIZE) {
+        return rowUsed[unit];
     }
-
-    if (cells[row][col] != EMPTY) {
-        return;
+    if (unit < 2 * GRID_SIZE) {
+        return colUsed[unit - GRID_SIZE];
     }
+    return boxUsed[unit - 2 * GRID_SIZE];
+}
 
-    std::set<int> &cellCandidates = candidates[row][col];
-    if (cellCandidates.count(digit)) {
-        cellCandidates.erase(digit);
-    } 
-    else {
-        cellCandidates.insert(digit);
-    }
+template <int BoxSize>
+const std::array<typename BasicGrid<BoxSize>::Index, BasicGrid<BoxSize>::GRID_SIZE>& BasicGrid<BoxSize>::unitCells(int unit) {
+    return UNITS<BoxSize>[unit];
 }
 
-bool Grid::isValid() const {
-    bool row[GRID_SIZE][GRID_SIZE] = {};
-    bool col[GRID_SIZE][GRID_SIZE] = {};
-    bool box[GRID_SIZE][GRID_SIZE] = {};
+template <int BoxSize>
+bool BasicGrid<BoxSize>::isValid() const {
+    std::array<Mask, GRID_SIZE> row = {};
+    std::array<Mask, GRID_SIZE> col = {};
+    std::array<Mask, GRID_SIZE> box = {};
 
     for (int i = 0; i < GRID_SIZE; ++i) {
         for (int j = 0; j < GRID_SIZE; ++j) {
-            if (cells[i][j] == EMPTY) {
+            const int val = cells[i * GRID_SIZE + j];
+            if (val == EMPTY) {
                 continue;
             }
 
-            int num = cells[i][j] - 1; 
-            int boxIdx = getBoxIndex(i, j);
+            const Mask bit = digitMask(val);
+            const int boxIdx = getBoxIndex(i, j);
 
-            if (row[i][num] || col[j][num] || box[boxIdx][num]) {
+            if ((row[i] | col[j] | box[boxIdx]) & bit) {
                 return false;
             }
-            row[i][num] = col[j][num] = box[boxIdx][num] = true;
+            row[i] |= bit;
+            col[j] |= bit;
+            box[boxIdx] |= bit;
         }
     }
     return true;
 }
 
-bool Grid::isComplete() const {
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            if (cells[row][col] == EMPTY) {
-                return false;
-            }
-        }
-    }
-    return isValid();
+template <int BoxSize>
+bool BasicGrid<BoxSize>::isComplete() const {
+    return filled == CELL_COUNT && isValid();
 }
 
-void Grid::printBoard() const {
+template <int BoxSize>
+void BasicGrid<BoxSize>::printBoard() const {
     std::string output;
     output.reserve(GRID_SIZE * (GRID_SIZE + 1));
 
     for (int row = 0; row < GRID_SIZE; ++row) {
         for (int col = 0; col < GRID_SIZE; ++col) {
-            int val = cells[row][col];
-            output += (val == EMPTY ? '0' : static_cast<char>('0' + val));
+            int val = cells[row * GRID_SIZE + col];
+            output += (val == EMPTY ? '0' : charFromDigit(val));
         }
         output += '\n';
     }
@@ -251,67 +551,190 @@ void Grid::printBoard() const {
     std::cout << output;
 }
 
-void Grid::prettyPrintBoard() const {
+template <int BoxSize>
+void BasicGrid<BoxSize>::prettyPrintBoard() const {
+    const std::string separator(2 * (GRID_SIZE + SUBGRID_SIZE) + 1, '-');
     std::ostringstream oss;
     for (int row = 0; row < GRID_SIZE; ++row) {
         if (row % SUBGRID_SIZE == 0) {
-            oss << "-------------------------\n";
+            oss << separator << '\n';
         }
         for (int col = 0; col < GRID_SIZE; ++col) {
             if (col % SUBGRID_SIZE == 0) {
                 oss << "| ";
             }
-            oss << (cells[row][col] == EMPTY ? '.' : static_cast<char>('0' + cells[row][col])) << ' ';
+            oss << (cells[row * GRID_SIZE + col] == EMPTY ? '.' : charFromDigit(cells[row * GRID_SIZE + col])) << ' ';
         }
         oss << "|\n";
     }
-    oss << "-------------------------\n";
+    oss << separator << '\n';
     std::cout << oss.str();
 }
 
-int Grid::getBoxIndex(int row, int col) const {
-    return (row / SUBGRID_SIZE) * SUBGRID_SIZE + (col / SUBGRID_SIZE);
-}
+template <int BoxSize>
+void BasicGrid<BoxSize>::rebuildUsedMasks() {
+    rowUsed.fill(0);
+    colUsed.fill(0);
+    boxUsed.fill(0);
 
-void Grid::updateAllCandidates() {
     for (int row = 0; row < GRID_SIZE; ++row) {
         for (int col = 0; col < GRID_SIZE; ++col) {
-            if (cells[row][col] != EMPTY) {
-                candidates[row][col].clear();
+            const int val = cells[row * GRID_SIZE + col];
+            if (val != EMPTY) {
+                rowUsed[row] |= digitMask(val);
+                colUsed[col] |= digitMask(val);
+                boxUsed[getBoxIndex(row, col)] |= digitMask(val);
             }
         }
     }
+}
 
-    std::array<std::set<int>, GRID_SIZE> rowForbidden;
-    std::array<std::set<int>, GRID_SIZE> colForbidden;
-    std::array<std::set<int>, GRID_SIZE> boxForbidden;
-
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            const int val = cells[row][col];
-            if (val != EMPTY) {
-                rowForbidden[row].insert(val);
-                colForbidden[col].insert(val);
-                boxForbidden[getBoxIndex(row, col)].insert(val);
+// SSE2 is part of every x86-64 CPU, so unlike the band solver kernels this needs no dispatch
+template <int BoxSize>
+int BasicGrid<BoxSize>::readLine(const char* line, std::uint8_t* values) {
+    int index = 0;
+#if defined(__SSE2__)
+    if constexpr (GRID_SIZE <= 9) {
+        // sixteen cells a step: a byte is a cell when it is '.' or c - '0' is at most GRID_SIZE
+        const __m128i zero = _mm_set1_epi8('0');
+        const __m128i largest = _mm_set1_epi8(GRID_SIZE);
+        const __m128i dot = _mm_set1_epi8('.');
+        for (; index + 16 <= CELL_COUNT; index += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + index));
+            const __m128i digits = _mm_sub_epi8(bytes, zero);
+            const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, largest), digits);
+            const int cellBits = _mm_movemask_epi8(_mm_or_si128(isDigit, _mm_cmpeq_epi8(bytes, dot)));
+            if (cellBits != 0xFFFF) {
+                return index + __builtin_ctz(~cellBits);
             }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(values + index), _mm_and_si128(digits, isDigit));
         }
     }
+#endif
+    for (; index < CELL_COUNT; ++index) {
+        const int val = digitFromChar(line[index]);
+        if (val < 0) {
+            return index;
+        }
+        values[index] = static_cast<std::uint8_t>(val);
+    }
+    return -1;
+}
 
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            if (cells[row][col] == EMPTY) {
-                std::set<int> possible;
-                const int boxIdx = getBoxIndex(row, col);
-                
-                for (int num : ALL_CANDIDATES) {
-                    if (!rowForbidden[row].count(num) &&
-                        !colForbidden[col].count(num) && 
-                        !boxForbidden[boxIdx].count(num)) {
-                        possible.insert(num);
-                    }
-                }
-                candidates[row][col] = std::move(possible);
-            }
+template <int BoxSize>
+void BasicGrid<BoxSize>::updateAllCandidates() {
+    rebuildUsedMasks();
+
+    filled = 0;
+    for (int index = 0; index < CELL_COUNT; ++index) {
+        candidates[index] = (cells[index] != EMPTY) ? 0 : ALL_MASK & ~usedMaskFor(index);
+        filled += cells[index] != EMPTY;
+    }
+    dirtyUnits = ALL_UNITS;
+}
+
+// only the PEER_COUNT peers of a cell can gain or lose the digit written there
+template <int BoxSize>
+void BasicGrid<BoxSize>::placeDigit(int index, int digit) {
+    const int row = index / GRID_SIZE;
+    const int col = index % GRID_SIZE;
+    const Mask bit = digitMask(digit);
+
+    cells[index] = static_cast<std::uint8_t>(digit);
+    candidates[index] = 0;
+    rowUsed[row] |= bit;
+    colUsed[col] |= bit;
+    boxUsed[getBoxIndex(row, col)] |= bit;
+    ++filled;
+    markDirty(index);
+
+    for (const Index peer : PEERS<BoxSize>[index]) {
+        if (candidates[peer] & bit) {
+            candidates[peer] &= static_cast<Mask>(~bit);
+            markDirty(peer);
+        }
+    }
+}
+
+template <int BoxSize>
+void BasicGrid<BoxSize>::removeDigit(int index) {
+    const int row = index / GRID_SIZE;
+    const int col = index % GRID_SIZE;
+    const int box = getBoxIndex(row, col);
+    const int digit = cells[index];
+    const Mask bit = digitMask(digit);
+
+    // a unit keeps the digit if a duplicate (invalid player move) is still there
+    cells[index] = EMPTY;
+    --filled;
+    markDirty(index);
+    bool inRow = false, inCol = false, inBox = false;
+    for (const Index peer : PEERS<BoxSize>[index]) {
+        if (cells[peer] == digit) {
+            inRow |= peer / GRID_SIZE == row;
+            inCol |= peer % GRID_SIZE == col;
+            inBox |= getBoxIndex(peer / GRID_SIZE, peer % GRID_SIZE) == box;
+        }
+    }
+    if (!inRow) rowUsed[row] &= static_cast<Mask>(~bit);
+    if (!inCol) colUsed[col] &= static_cast<Mask>(~bit);
+    if (!inBox) boxUsed[box] &= static_cast<Mask>(~bit);
+
+    for (const Index peer : PEERS<BoxSize>[index]) {
+        if (cells[peer] == EMPTY && !(usedMaskFor(peer) & bit) && !(candidates[peer] & bit)) {
+            candidates[peer] |= bit;
+            markDirty(peer);
         }
     }
-}
\ No newline at end of file
+    candidates[index] = ALL_MASK & ~usedMaskFor(index);
+}
+
+template <int BoxSize>
+int BasicGrid<BoxSize>::digitFromChar(char c) {
+    int digit = -1;
+    if (c == '.') {
+        digit = EMPTY;
+    }
+    else if (c >= '0' && c <= '9') {
+        digit = c - '0';
+    }
+    else if (c >= 'A' && c <= 'Z') {
+        digit = c - 'A' + 10;
+    }
+    else if (c >= 'a' && c <= 'z') {
+        digit = c - 'a' + 10;
+    }
+    return digit <= GRID_SIZE ? digit : -1;
+}
+
+template <int BoxSize>
+char BasicGrid<BoxSize>::charFromDigit(int digit) {
+    return static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+}
+
+template <int BoxSize>
+typename BasicGrid<BoxSize>::Mask BasicGrid<BoxSize>::usedMaskFor(int index) const {
+    const int row = index / GRID_SIZE;
+    const int col = index % GRID_SIZE;
+    return rowUsed[row] | colUsed[col] | boxUsed[getBoxIndex(row, col)];
+}
+
+template <int BoxSize>
+void BasicGrid<BoxSize>::markDirty(int index) {
+    dirtyUnits |= CELL_UNITS<BoxSize>[index];
+}
+
+template <int BoxSize>
+typename BasicGrid<BoxSize>::Mask& BasicGrid<BoxSize>::unitMask(int slot) {
+    if (slot < GRID_SIZE) {
+        return rowUsed[slot];
+    }
+    if (slot < 2 * GRID_SIZE) {
+        return colUsed[slot - GRID_SIZE];
+    }
+    return boxUsed[slot - 2 * GRID_SIZE];
+}
+
+template class BasicGrid<3>;
+template class BasicGrid<4>;
+template class BasicGrid<5>;
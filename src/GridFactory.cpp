@@ -0,0 +1,220 @@
+#include "GridFactory.hpp"
+#include <algorithm>
+#include <random>
+
+namespace {
+    // row, column and box of every cell
+    template <int BoxSize>
+    struct CellUnits {
+        static constexpr int SIZE = BoxSize * BoxSize;
+        std::uint8_t row[SIZE * SIZE]{};
+        std::uint8_t col[SIZE * SIZE]{};
+        std::uint8_t box[SIZE * SIZE]{};
+
+        constexpr CellUnits() {
+            for (int index = 0; index < SIZE * SIZE; ++index) {
+                row[index] = static_cast<std::uint8_t>(index / SIZE);
+                col[index] = static_cast<std::uint8_t>(index % SIZE);
+                box[index] = static_cast<std::uint8_t>(index / SIZE / BoxSize * BoxSize + index % SIZE / BoxSize);
+            }
+        }
+    };
+
+    template <int BoxSize>
+    constexpr CellUnits<BoxSize> UNITS_OF;
+
+    struct ByteCounts {
+        std::uint8_t bits[256]{};
+
+        constexpr ByteCounts() {
+            for (int byte = 1; byte < 256; ++byte) {
+                bits[byte] = static_cast<std::uint8_t>(bits[byte >> 1] + (byte & 1));
+            }
+        }
+    };
+
+    constexpr ByteCounts BYTE_COUNTS;
+
+    // without -mpopcnt the builtin is a library call, and here it sits in the innermost loop
+    template <typename Mask>
+    int countDigits(Mask mask) {
+        int count = 0;
+        for (; mask; mask = static_cast<Mask>(mask >> 8)) {
+            count += BYTE_COUNTS.bits[mask & 0xFF];
+        }
+        return count;
+    }
+
+    std::uint64_t randomSeed() {
+        std::random_device device;
+        return static_cast<std::uint64_t>(device()) << 32 | device();
+    }
+}
+
+template <int BoxSize>
+BasicGridFactory<BoxSize>::BasicGridFactory() : BasicGridFactory(randomSeed()) {}
+
+template <int BoxSize>
+BasicGridFactory<BoxSize>::BasicGridFactory(std::uint64_t seed)
+    : rng(seed), transformsPerSearch(DEFAULT_TRANSFORMS_PER_SEARCH), transformsLeft(0) {}
+
+template <int BoxSize>
+typename BasicGridFactory<BoxSize>::Grid BasicGridFactory<BoxSize>::next() {
+    std::uint8_t cells[Grid::CELL_COUNT];
+    next(cells);
+    Grid grid;
+    grid.loadFromCells(cells);
+    for (int row = 0; row < Grid::GRID_SIZE; ++row) {
+        for (int col = 0; col < Grid::GRID_SIZE; ++col) {
+            grid.setCellState(row, col, CellState::Editable);
+        }
+    }
+    return grid;
+}
+
+template <int BoxSize>
+void BasicGridFactory<BoxSize>::next(std::uint8_t* cells) {
+    if (transformsLeft == 0) {
+        search();
+        transformsLeft = transformsPerSearch;
+    }
+    --transformsLeft;
+    transform(cells);
+}
+
+// almost every 9x9 attempt succeeds without backtracking far, larger boards sometimes paint
+// themselves into a corner that a fresh start gets out of faster than backtracking does
+template <int BoxSize>
+void BasicGridFactory<BoxSize>::search() {
+    for (;;) {
+        base.fill(Grid::EMPTY);
+        rowUsed.fill(0);
+        colUsed.fill(0);
+        boxUsed.fill(0);
+        for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+            empty[index] = static_cast<typename Grid::Index>(index);
+        }
+        emptyCount = Grid::CELL_COUNT;
+        std::uint64_t nodesLeft = RESTART_NODES;
+        if (fill(nodesLeft)) {
+            return;
+        }
+    }
+}
+
+template <int BoxSize>
+bool BasicGridFactory<BoxSize>::fill(std::uint64_t& nodesLeft) {
+    if (nodesLeft == 0) {
+        return false;
+    }
+    --nodesLeft;
+
+    if (emptyCount == 0) {
+        return true;
+    }
+    const CellUnits<BoxSize>& units = UNITS_OF<BoxSize>;
+    int branch = 0;
+    int fewest = Grid::GRID_SIZE + 1;
+    Mask options = 0;
+    for (int at = 0; at < emptyCount && fewest > 1; ++at) {
+        const int index = empty[at];
+        const Mask cand = Grid::ALL_MASK & ~(rowUsed[units.row[index]] | colUsed[units.col[index]] | boxUsed[units.box[index]]);
+        const int count = countDigits(cand);
+        if (count < fewest) {
+            fewest = count;
+            branch = at;
+            options = cand;
+        }
+    }
+
+    // the branch cell moves behind the empty ones. The rest keep their order, so ties go to the
+    // first cell in reading order, which keeps larger boards from painting themselves into corners
+    const int branchCell = empty[branch];
+    std::copy(empty.begin() + branch + 1, empty.begin() + emptyCount, empty.begin() + branch);
+    empty[emptyCount - 1] = static_cast<typename Grid::Index>(branchCell);
+    --emptyCount;
+    const int row = units.row[branchCell];
+    const int col = units.col[branchCell];
+    const int box = units.box[branchCell];
+    for (int left = fewest; left > 0; --left) {
+        Mask pick = options;
+        for (int skip = static_cast<int>(rng.below(left)); skip > 0; --skip) {
+            pick &= pick - 1;
+        }
+        const int digit = Grid::lowestDigit(pick);
+        const Mask bit = Grid::digitMask(digit);
+        options &= static_cast<Mask>(~bit);
+
+        base[branchCell] = static_cast<std::uint8_t>(digit);
+        rowUsed[row] |= bit;
+        colUsed[col] |= bit;
+        boxUsed[box] |= bit;
+        if (fill(nodesLeft)) {
+            return true;
+        }
+        base[branchCell] = Grid::EMPTY;
+        rowUsed[row] &= static_cast<Mask>(~bit);
+        colUsed[col] &= static_cast<Mask>(~bit);
+        boxUsed[box] &= static_cast<Mask>(~bit);
+    }
+    std::copy_backward(empty.begin() + branch, empty.begin() + emptyCount, empty.begin() + emptyCount + 1);
+    empty[branch] = static_cast<typename Grid::Index>(branchCell);
+    ++emptyCount;
+    return false;
+}
+
+template <int BoxSize>
+void BasicGridFactory<BoxSize>::transform(std::uint8_t* cells) {
+    std::uint8_t rows[Grid::GRID_SIZE];
+    std::uint8_t cols[Grid::GRID_SIZE];
+    std::uint8_t digits[Grid::GRID_SIZE + 1];
+    linePermutation(rows);
+    linePermutation(cols);
+    for (int digit = 0; digit <= Grid::GRID_SIZE; ++digit) {
+        digits[digit] = static_cast<std::uint8_t>(digit);
+    }
+    shuffle(digits + 1, Grid::GRID_SIZE);
+    const bool transposed = rng() >> 63;
+
+    for (int row = 0; row < Grid::GRID_SIZE; ++row) {
+        for (int col = 0; col < Grid::GRID_SIZE; ++col) {
+            const int from = transposed ? cols[col] * Grid::GRID_SIZE + rows[row] : rows[row] * Grid::GRID_SIZE + cols[col];
+            cells[row * Grid::GRID_SIZE + col] = digits[base[from]];
+        }
+    }
+}
+
+template <int BoxSize>
+void BasicGridFactory<BoxSize>::linePermutation(std::uint8_t* lines) {
+    std::uint8_t bands[BoxSize];
+    std::uint8_t inside[BoxSize];
+    for (int i = 0; i < BoxSize; ++i) {
+        bands[i] = static_cast<std::uint8_t>(i);
+    }
+    shuffle(bands, BoxSize);
+    for (int band = 0; band < BoxSize; ++band) {
+        for (int i = 0; i < BoxSize; ++i) {
+            inside[i] = static_cast<std::uint8_t>(i);
+        }
+        shuffle(inside, BoxSize);
+        for (int i = 0; i < BoxSize; ++i) {
+            lines[band * BoxSize + i] = static_cast<std::uint8_t>(bands[band] * BoxSize + inside[i]);
+        }
+    }
+}
+
+// Fisher-Yates
+template <int BoxSize>
+template <typename T>
+void BasicGridFactory<BoxSize>::shuffle(T* items, int count) {
+    for (int i = count - 1; i > 0; --i) {
+        const int j = static_cast<int>(rng.below(static_cast<std::uint32_t>(i + 1)));
+        const T item = items[i];
+        items[i] = items[j];
+        items[j] = item;
+    }
+}
+
+template class BasicGridFactory<3>;
+template class BasicGridFactory<4>;
+template class BasicGridFactory<5>;
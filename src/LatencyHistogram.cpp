@@ -0,0 +1,68 @@
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+
+LatencyHistogram::LatencyHistogram() {
+    clear();
+}
+
+void LatencyHistogram::record(std::uint64_t nanos) {
+    ++buckets[bucketOf(nanos)];
+    ++total;
+    largest = std::max(largest, nanos);
+    sum += nanos;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    total += other.total;
+    largest = std::max(largest, other.largest);
+    sum += other.sum;
+}
+
+void LatencyHistogram::clear() {
+    buckets.fill(0);
+    total = 0;
+    largest = 0;
+    sum = 0;
+}
+
+double LatencyHistogram::mean() const {
+    return total ? static_cast<double>(sum / total) : 0.0;
+}
+
+std::uint64_t LatencyHistogram::percentile(double fraction) const {
+    if (total == 0) {
+        return 0;
+    }
+    const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(fraction * total + 0.5));
+    std::uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(upperBound(i), largest);
+        }
+    }
+    return largest;
+}
+
+// values below SUB_BUCKETS get their own bucket, larger ones keep their top SUB_BUCKET_BITS + 1 bits
+int LatencyHistogram::bucketOf(std::uint64_t nanos) {
+    if (nanos < SUB_BUCKETS) {
+        return static_cast<int>(nanos);
+    }
+    const int exponent = 63 - __builtin_clzll(nanos);
+    const int sub = static_cast<int>((nanos >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+std::uint64_t LatencyHistogram::upperBound(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return static_cast<std::uint64_t>(bucket);
+    }
+    const int exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    const std::uint64_t sub = static_cast<std::uint64_t>(bucket % SUB_BUCKETS);
+    const std::uint64_t base = (std::uint64_t{1} << exponent) | (sub << (exponent - SUB_BUCKET_BITS));
+    return base + (std::uint64_t{1} << (exponent - SUB_BUCKET_BITS)) - 1;
+}
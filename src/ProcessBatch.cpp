@@ -0,0 +1,240 @@
+#include "ProcessBatch.hpp"
+#include "BatchIO.hpp"
+#include "Grid.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t OUTPUT_FLUSH_BYTES = 1 << 20;
+
+    // a job in input order. Lines that do not parse never reach the ring
+    struct Pending {
+        const char* line;
+        std::size_t length;
+        bool submitted;
+    };
+
+    enum class Fed { Submitted, Full, End };
+
+    pid_t spawnWorker(SharedRing& ring) {
+        const pid_t pid = ::fork();
+        if (pid < 0) {
+            throw std::runtime_error(std::string("ProcessBatch - Cannot fork a worker: ") + std::strerror(errno));
+        }
+        if (pid == 0) {
+            // _exit: the child shares the coordinator's objects and must not run their destructors
+            int status = 0;
+            try {
+                ring.run();
+            }
+            catch (...) {
+                status = 1;
+            }
+            ::_exit(status);
+        }
+        return pid;
+    }
+
+    // runs the ring until feed has nothing left and every pending job is written.
+    // feed places the next job, emit formats a finished one (result is nullptr for an invalid line)
+    template <typename Feed, typename Emit>
+    void coordinate(const ProcessBatch::Options& options, int outputFd, ProcessBatch::Summary& summary, Feed feed, Emit emit) {
+        SharedRing ring("/sudoku-ring-" + std::to_string(::getpid()), std::max<std::size_t>(options.slots, 1));
+        const unsigned processes = options.processes ? options.processes : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<pid_t> workers;
+        std::deque<Pending> pending;
+        std::string output;
+        output.reserve(OUTPUT_FLUSH_BYTES + 4 * Grid::CELL_COUNT);
+
+        auto stopWorkers = [&]() {
+            ring.stop();
+            for (pid_t worker : workers) {
+                int status;
+                while (::waitpid(worker, &status, 0) < 0 && errno == EINTR) {
+                }
+            }
+            workers.clear();
+        };
+
+        // dead workers are replaced, their jobs go back to the ring
+        auto reap = [&]() {
+            int status;
+            pid_t pid;
+            while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+                const auto worker = std::find(workers.begin(), workers.end(), pid);
+                if (worker == workers.end()) {
+                    continue;
+                }
+                ++summary.workerDeaths;
+                summary.retried += ring.recover(pid);
+                *worker = spawnWorker(ring);
+            }
+        };
+
+        try {
+            for (unsigned i = 0; i < processes; ++i) {
+                workers.push_back(spawnWorker(ring));
+            }
+
+            bool fed = false;
+            for (;;) {
+                bool progress = false;
+                Fed state = Fed::Submitted;
+                while (!fed && (state = feed(ring, pending)) == Fed::Submitted) {
+                    progress = true;
+                }
+                fed = fed || state == Fed::End;
+
+                SharedRing::Result result;
+                while (!pending.empty()) {
+                    const Pending& job = pending.front();
+                    if (job.submitted && !ring.collect(result)) {
+                        break;
+                    }
+                    ++summary.jobs;
+                    emit(job, job.submitted ? &result : nullptr, output);
+                    pending.pop_front();
+                    progress = true;
+                }
+                if (output.size() >= OUTPUT_FLUSH_BYTES || (fed && pending.empty())) {
+                    BatchIO::writeAll(outputFd, output.data(), output.size(), "ProcessBatch");
+                    output.clear();
+                }
+                if (fed && pending.empty()) {
+                    break;
+                }
+                if (!progress) {
+                    reap();
+                    ring.waitForResults(10);
+                }
+            }
+        }
+        catch (...) {
+            stopWorkers();
+            throw;
+        }
+        stopWorkers();
+    }
+
+    // the words SolverClient uses for the same results
+    const char* outcomeSuffix(SharedRing::Job job, SharedRing::Outcome outcome) {
+        switch (outcome) {
+            case SharedRing::Outcome::Unsolvable: return job == SharedRing::Job::Unique ? " no-solution" : " unsolved";
+            case SharedRing::Outcome::Unique:     return " unique";
+            case SharedRing::Outcome::NotUnique:  return " not-unique";
+            case SharedRing::Outcome::Failed:     return " failed";
+            default:                              return "";
+        }
+    }
+
+    void appendDigits(const std::uint8_t* cells, std::string& output) {
+        for (int i = 0; i < Grid::CELL_COUNT; ++i) {
+            output.push_back(static_cast<char>('0' + cells[i]));
+        }
+    }
+}
+
+ProcessBatch::Summary ProcessBatch::run(const std::string& inputPath, int outputFd, const Options& options) {
+    if (options.job == SharedRing::Job::Generate) {
+        throw std::invalid_argument("ProcessBatch::run - Generate jobs take a count, use ProcessBatch::generate");
+    }
+    const Clock::time_point start = Clock::now();
+    const MappedFile input(inputPath);
+    const char* next = input.data();
+    const char* const end = input.data() + input.size();
+    const int option = static_cast<int>(options.strategy);
+    Summary summary;
+
+    auto feed = [&](SharedRing& ring, std::deque<Pending>& pending) {
+        std::uint8_t cells[Grid::CELL_COUNT];
+        // a line the ring has no room for is read again on the next call
+        const char* const at = next;
+        std::string_view line;
+        if (!BatchIO::nextLine(next, end, line)) {
+            return Fed::End;
+        }
+        const bool valid = static_cast<bool>(Grid::parseCells(line, cells));
+        if (valid && !ring.submit(options.job, cells, option)) {
+            next = at;
+            return Fed::Full;
+        }
+        pending.push_back({line.data(), line.size(), valid});
+        return Fed::Submitted;
+    };
+
+    auto emit = [&](const Pending& job, const SharedRing::Result* result, std::string& output) {
+        if (!result) {
+            ++summary.invalid;
+            output.append(job.line, job.length).append(" invalid");
+        }
+        else if (result->outcome == SharedRing::Outcome::Solved) {
+            appendDigits(result->cells, output);
+        }
+        else {
+            summary.failed += result->outcome == SharedRing::Outcome::Failed;
+            output.append(job.line, job.length).append(outcomeSuffix(result->job, result->outcome));
+        }
+        output.push_back('\n');
+    };
+
+    coordinate(options, outputFd, summary, feed, emit);
+    summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return summary;
+}
+
+ProcessBatch::Summary ProcessBatch::generate(std::size_t count, int outputFd, const Options& options) {
+    const Clock::time_point start = Clock::now();
+    const int option = static_cast<int>(options.difficulty);
+    std::size_t generated = 0;
+    Summary summary;
+
+    auto feed = [&](SharedRing& ring, std::deque<Pending>& pending) {
+        if (generated == count) {
+            return Fed::End;
+        }
+        if (!ring.submit(SharedRing::Job::Generate, nullptr, option, options.seed + generated)) {
+            return Fed::Full;
+        }
+        pending.push_back({nullptr, 0, true});
+        ++generated;
+        return Fed::Submitted;
+    };
+
+    auto emit = [&](const Pending&, const SharedRing::Result* result, std::string& output) {
+        if (result->outcome == SharedRing::Outcome::Generated) {
+            appendDigits(result->cells, output);
+        }
+        else {
+            ++summary.failed;
+            output.append("failed");
+        }
+        output.push_back('\n');
+    };
+
+    coordinate(options, outputFd, summary, feed, emit);
+    summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return summary;
+}
+
+void ProcessBatch::printSummary(const Summary& summary, std::ostream& out) {
+    const double rate = summary.seconds > 0 ? summary.jobs / summary.seconds : 0.0;
+    out << std::fixed << std::setprecision(2)
+        << "jobs:       " << summary.jobs << " (" << summary.invalid << " invalid, " << summary.failed << " failed)\n"
+        << "workers:    " << summary.workerDeaths << " died, " << summary.retried << " jobs retried\n"
+        << "wall time:  " << summary.seconds << " s\n"
+        << "throughput: " << rate << " jobs/s\n";
+}
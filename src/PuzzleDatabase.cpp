@@ -0,0 +1,384 @@
+#include "PuzzleDatabase.hpp"
+#include "BandSolver.hpp"
+#include "BatchIO.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "PuzzleDatabase reads its integers straight from the map");
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Id = PuzzleDatabase::Id;
+
+    constexpr char MAGIC[4] = {'S', 'D', 'K', 'D'};
+    constexpr std::uint32_t VERSION = 1;
+    constexpr int GROUP_COUNT = Grid::CELL_COUNT / 3;
+    constexpr int CLUE_KEYS = Grid::CELL_COUNT + 1;
+
+    static_assert(Grid::CELL_COUNT % 3 == 0 && (GROUP_COUNT * 10 + 7) / 8 == PuzzleDatabase::CELL_BYTES &&
+                  5 * (GROUP_COUNT / 4) + 4 == PuzzleDatabase::CELL_BYTES,
+                  "PuzzleDatabase - cell groups must fill CELL_BYTES");
+
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t count;
+        std::uint32_t recordBytes;
+        std::uint32_t ratingKeys;
+        std::uint32_t clueKeys;
+        std::uint32_t reserved;
+        std::uint64_t recordsOffset;
+        std::uint64_t ratingIndexOffset;
+        std::uint64_t clueIndexOffset;
+        std::uint64_t fileBytes;
+    };
+
+    static_assert(sizeof(Header) == 64, "PuzzleDatabase header must stay 64 bytes");
+
+    // digits of every 10 bit group value, values past 999 never occur in a valid file
+    struct GroupTable {
+        std::array<std::array<std::uint8_t, 3>, 1024> digits{};
+
+        constexpr GroupTable() {
+            for (int value = 0; value < 1000; ++value) {
+                digits[value][0] = static_cast<std::uint8_t>(value / 100);
+                digits[value][1] = static_cast<std::uint8_t>(value / 10 % 10);
+                digits[value][2] = static_cast<std::uint8_t>(value % 10);
+            }
+        }
+    };
+
+    constexpr GroupTable GROUPS;
+
+    using Chunk = BatchIO::Chunk;
+
+    struct PackedChunk {
+        std::vector<std::uint8_t> records;
+        std::size_t skipped = 0;
+    };
+
+    constexpr std::uint64_t align8(std::uint64_t offset) {
+        return (offset + 7) & ~std::uint64_t(7);
+    }
+
+    constexpr std::uint64_t indexBytes(int keys, std::uint64_t count) {
+        return align8(sizeof(std::uint64_t) * (keys + 1) + sizeof(Id) * count);
+    }
+
+    void packChunk(const Chunk& chunk, bool rate, PackedChunk& packed) {
+        packed.records.reserve((chunk.end - chunk.begin) / (Grid::CELL_COUNT + 1) * PuzzleDatabase::RECORD_BYTES);
+        std::uint8_t cells[Grid::CELL_COUNT];
+
+        std::string_view line;
+        for (const char* next = chunk.begin; BatchIO::nextLine(next, chunk.end, line);) {
+            if (Grid::parseCells(line, cells)) {
+                const std::size_t at = packed.records.size();
+                packed.records.resize(at + PuzzleDatabase::RECORD_BYTES);
+                std::uint8_t* record = packed.records.data() + at;
+                PuzzleDatabase::encode(cells, record);
+                record[PuzzleDatabase::CELL_BYTES] = static_cast<std::uint8_t>(
+                    Grid::CELL_COUNT - std::count(cells, cells + Grid::CELL_COUNT, 0));
+                record[PuzzleDatabase::CELL_BYTES + 1] = static_cast<std::uint8_t>(
+                    rate ? PuzzleDatabase::rate(cells) : PuzzleDatabase::UNRATED);
+            }
+            else {
+                ++packed.skipped;
+            }
+        }
+    }
+
+    void writePadding(int fd, std::uint64_t offset) {
+        static const char zeros[8] = {};
+        BatchIO::writeAll(fd, zeros, align8(offset) - offset, "PuzzleDatabase");
+    }
+
+    // counting sort of ids by key: bucket starts, then the ids, ascending inside each bucket
+    void writeIndex(int fd, const std::vector<std::uint8_t>& keys, int keyCount, std::vector<Id>& ids) {
+        std::vector<std::uint64_t> starts(keyCount + 1, 0);
+        for (std::uint8_t key : keys) {
+            ++starts[key + 1];
+        }
+        for (int key = 0; key < keyCount; ++key) {
+            starts[key + 1] += starts[key];
+        }
+
+        std::vector<std::uint64_t> next(starts.begin(), starts.end() - 1);
+        ids.resize(keys.size());
+        for (std::size_t id = 0; id < keys.size(); ++id) {
+            ids[next[keys[id]]++] = static_cast<Id>(id);
+        }
+
+        BatchIO::writeAll(fd, starts.data(), starts.size() * sizeof(std::uint64_t), "PuzzleDatabase");
+        BatchIO::writeAll(fd, ids.data(), ids.size() * sizeof(Id), "PuzzleDatabase");
+        writePadding(fd, starts.size() * sizeof(std::uint64_t) + ids.size() * sizeof(Id));
+    }
+
+    // `ids` yields record ids, written out as text lines through one reused buffer
+    template <typename Ids>
+    void writeLines(const PuzzleDatabase& database, int fd, const Ids& ids) {
+        constexpr std::size_t LINE = Grid::CELL_COUNT + 1;
+        std::string buffer;
+        buffer.reserve(1 << 20);
+        std::uint8_t cells[Grid::CELL_COUNT];
+
+        for (auto id : ids) {
+            database.cells(id, cells);
+            const std::size_t at = buffer.size();
+            buffer.resize(at + LINE);
+            for (int i = 0; i < Grid::CELL_COUNT; ++i) {
+                buffer[at + i] = static_cast<char>('0' + cells[i]);
+            }
+            buffer[at + Grid::CELL_COUNT] = '\n';
+            if (buffer.size() + LINE > buffer.capacity()) {
+                BatchIO::writeAll(fd, buffer.data(), buffer.size(), "PuzzleDatabase");
+                buffer.clear();
+            }
+        }
+        BatchIO::writeAll(fd, buffer.data(), buffer.size(), "PuzzleDatabase");
+    }
+
+    // 0, 1, ... count - 1 without materializing them
+    struct AllIds {
+        std::size_t count;
+
+        struct Iterator {
+            std::size_t id;
+            std::size_t operator*() const { return id; }
+            Iterator& operator++() { ++id; return *this; }
+            bool operator!=(const Iterator& other) const { return id != other.id; }
+        };
+
+        Iterator begin() const { return {0}; }
+        Iterator end() const { return {count}; }
+    };
+}
+
+PuzzleDatabase::PuzzleDatabase(const std::string& path)
+    : file(path, MappedFile::Access::Random), count(0), records(nullptr),
+      ratingStarts(nullptr), ratingIds(nullptr), clueStarts(nullptr), clueIds(nullptr) {
+    Header header;
+    if (file.size() < sizeof(Header)) {
+        throw std::runtime_error("PuzzleDatabase - " + path + " is too short for a header");
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        throw std::runtime_error("PuzzleDatabase - " + path + " is not a version " + std::to_string(VERSION) + " puzzle database");
+    }
+
+    const std::uint64_t recordsSize = header.count * RECORD_BYTES;
+    if (header.recordBytes != RECORD_BYTES || header.ratingKeys != RATING_COUNT || header.clueKeys != CLUE_KEYS ||
+        header.count > UINT32_MAX || header.fileBytes != file.size() ||
+        header.recordsOffset != sizeof(Header) ||
+        header.ratingIndexOffset != align8(header.recordsOffset + recordsSize) ||
+        header.clueIndexOffset != header.ratingIndexOffset + indexBytes(RATING_COUNT, header.count) ||
+        header.fileBytes != header.clueIndexOffset + indexBytes(CLUE_KEYS, header.count)) {
+        throw std::runtime_error("PuzzleDatabase - " + path + " has an inconsistent header");
+    }
+
+    const auto* base = reinterpret_cast<const std::uint8_t*>(file.data());
+    count = static_cast<std::size_t>(header.count);
+    records = base + header.recordsOffset;
+    ratingStarts = reinterpret_cast<const std::uint64_t*>(base + header.ratingIndexOffset);
+    ratingIds = reinterpret_cast<const Id*>(ratingStarts + RATING_COUNT + 1);
+    clueStarts = reinterpret_cast<const std::uint64_t*>(base + header.clueIndexOffset);
+    clueIds = reinterpret_cast<const Id*>(clueStarts + CLUE_KEYS + 1);
+
+    // ranges are handed out unchecked, so the bucket starts must be in order and in bounds,
+    // and every id they cover must name a record
+    const auto inOrder = [&](const std::uint64_t* starts, int keys) {
+        return starts[0] == 0 && starts[keys] == count && std::is_sorted(starts, starts + keys + 1);
+    };
+    const auto inRange = [&](const Id* ids) {
+        return std::all_of(ids, ids + count, [&](Id id) { return id < count; });
+    };
+    if (!inOrder(ratingStarts, RATING_COUNT) || !inOrder(clueStarts, CLUE_KEYS) ||
+        !inRange(ratingIds) || !inRange(clueIds)) {
+        throw std::runtime_error("PuzzleDatabase - " + path + " has a corrupt index");
+    }
+}
+
+Grid PuzzleDatabase::puzzle(std::size_t id) const {
+    if (id >= count) {
+        throw std::out_of_range("PuzzleDatabase::puzzle - Id " + std::to_string(id) + " is out of range");
+    }
+    std::uint8_t values[Grid::CELL_COUNT];
+    cells(id, values);
+    Grid grid;
+    grid.loadFromCells(values);
+    return grid;
+}
+
+PuzzleDatabase::IdRange PuzzleDatabase::withRating(int minRating, int maxRating) const {
+    minRating = std::max(minRating, 0);
+    maxRating = std::min(maxRating, RATING_COUNT - 1);
+    if (minRating > maxRating) {
+        return {ratingIds, ratingIds};
+    }
+    return {ratingIds + ratingStarts[minRating], ratingIds + ratingStarts[maxRating + 1]};
+}
+
+PuzzleDatabase::IdRange PuzzleDatabase::withClues(int minClues, int maxClues) const {
+    minClues = std::max(minClues, 0);
+    maxClues = std::min(maxClues, Grid::CELL_COUNT);
+    if (minClues > maxClues) {
+        return {clueIds, clueIds};
+    }
+    return {clueIds + clueStarts[minClues], clueIds + clueStarts[maxClues + 1]};
+}
+
+PuzzleDatabase::IdRange PuzzleDatabase::withDifficulty(GeneratorDifficulty difficulty) const {
+    switch (difficulty) {
+        case GeneratorDifficulty::EASY:   return withClues(35, Grid::CELL_COUNT);
+        case GeneratorDifficulty::MEDIUM: return withClues(30, 34);
+        case GeneratorDifficulty::HARD:   return withClues(25, 29);
+        case GeneratorDifficulty::EXPERT: return withClues(0, 24);
+    }
+    return {clueIds, clueIds};
+}
+
+void PuzzleDatabase::writeText(int fd) const {
+    writeLines(*this, fd, AllIds{count});
+}
+
+void PuzzleDatabase::writeText(int fd, IdRange ids) const {
+    writeLines(*this, fd, ids);
+}
+
+// Records are packed chunk by chunk, a window of chunks at a time on the pool, and written in
+// input order. Only the two key bytes per puzzle stay in memory for the indexes at the end
+PuzzleDatabase::PackSummary PuzzleDatabase::pack(const std::string& textPath, const std::string& databasePath, const PackOptions& options) {
+    const Clock::time_point start = Clock::now();
+    const MappedFile input(textPath);
+    const std::vector<Chunk> chunks = BatchIO::split(input.data(), input.size(), options.chunkBytes);
+
+    const int fd = ::open(databasePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("PuzzleDatabase::pack - Cannot open " + databasePath + ": " + std::strerror(errno));
+    }
+
+    PackSummary summary;
+    try {
+        Header header = {};
+        BatchIO::writeAll(fd, &header, sizeof(Header), "PuzzleDatabase");
+
+        ThreadPool pool(options.threads);
+        const std::size_t window = 4 * static_cast<std::size_t>(pool.size());
+        std::vector<PackedChunk> packed(window);
+        std::vector<std::uint8_t> clues;
+        std::vector<std::uint8_t> ratings;
+
+        for (std::size_t first = 0; first < chunks.size(); first += window) {
+            const std::size_t last = std::min(chunks.size(), first + window);
+            for (std::size_t index = first; index < last; ++index) {
+                PackedChunk& slot = packed[index - first];
+                slot = PackedChunk();
+                pool.submit([&chunk = chunks[index], &slot, rate = options.rate] { packChunk(chunk, rate, slot); });
+            }
+            pool.waitIdle();
+
+            for (std::size_t index = first; index < last; ++index) {
+                const PackedChunk& slot = packed[index - first];
+                BatchIO::writeAll(fd, slot.records.data(), slot.records.size(), "PuzzleDatabase");
+                for (std::size_t at = 0; at < slot.records.size(); at += RECORD_BYTES) {
+                    clues.push_back(slot.records[at + CELL_BYTES]);
+                    ratings.push_back(slot.records[at + CELL_BYTES + 1]);
+                }
+                summary.skipped += slot.skipped;
+            }
+        }
+
+        summary.puzzles = clues.size();
+        if (summary.puzzles > UINT32_MAX) {
+            throw std::runtime_error("PuzzleDatabase::pack - More than 2^32 puzzles in " + textPath);
+        }
+
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.count = summary.puzzles;
+        header.recordBytes = RECORD_BYTES;
+        header.ratingKeys = RATING_COUNT;
+        header.clueKeys = CLUE_KEYS;
+        header.recordsOffset = sizeof(Header);
+        header.ratingIndexOffset = align8(header.recordsOffset + header.count * RECORD_BYTES);
+        header.clueIndexOffset = header.ratingIndexOffset + indexBytes(RATING_COUNT, header.count);
+        header.fileBytes = header.clueIndexOffset + indexBytes(CLUE_KEYS, header.count);
+
+        writePadding(fd, header.count * RECORD_BYTES);
+        std::vector<Id> ids;
+        writeIndex(fd, ratings, RATING_COUNT, ids);
+        writeIndex(fd, clues, CLUE_KEYS, ids);
+
+        if (::pwrite(fd, &header, sizeof(Header), 0) != static_cast<ssize_t>(sizeof(Header))) {
+            throw std::runtime_error(std::string("PuzzleDatabase::pack - Cannot write header: ") + std::strerror(errno));
+        }
+    }
+    catch (...) {
+        ::close(fd);
+        ::unlink(databasePath.c_str());
+        throw;
+    }
+
+    if (::close(fd) != 0) {
+        throw std::runtime_error("PuzzleDatabase::pack - Cannot close " + databasePath + ": " + std::strerror(errno));
+    }
+    summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return summary;
+}
+
+int PuzzleDatabase::rate(const std::uint8_t* cells) {
+    Grid grid;
+    grid.loadFromCells(cells);
+    if (!grid.isValid()) {
+        return NOT_UNIQUE;
+    }
+
+    // sound techniques only finish a puzzle with one solution
+    SolverStats stats;
+    if (Solver::solve(grid, Solver::Strategy::HUMAN, stats) && grid.isComplete()) {
+        for (int technique = SolverStats::TECHNIQUE_COUNT - 1; technique > 0; --technique) {
+            const SolverStats::Technique& used = stats.techniques[technique];
+            if (used.placements || used.eliminations) {
+                return technique + 1;
+            }
+        }
+        return 1;
+    }
+    return BandSolver::solveCells(cells, nullptr, 2) == 1 ? NEEDS_SEARCH : NOT_UNIQUE;
+}
+
+void PuzzleDatabase::encode(const std::uint8_t* cells, std::uint8_t* out) {
+    std::memset(out, 0, CELL_BYTES);
+    for (int group = 0; group < GROUP_COUNT; ++group) {
+        const std::uint8_t* digits = cells + 3 * group;
+        const unsigned value = (digits[0] * 100u + digits[1] * 10u + digits[2]) << (group * 10 & 7);
+        std::uint8_t* at = out + group * 10 / 8;
+        at[0] |= static_cast<std::uint8_t>(value);
+        at[1] |= static_cast<std::uint8_t>(value >> 8);
+    }
+}
+
+// four groups fill five bytes exactly, so each block of four is one unaligned load. The
+// last block holds three groups in four bytes and must not read past the cells
+void PuzzleDatabase::decode(const std::uint8_t* in, std::uint8_t* cells) {
+    constexpr int FULL_BLOCKS = GROUP_COUNT / 4;
+    for (int block = 0; block < FULL_BLOCKS; ++block) {
+        std::uint64_t bits;
+        std::memcpy(&bits, in + 5 * block, sizeof(bits));
+        for (int group = 0; group < 4; ++group) {
+            std::memcpy(cells + 12 * block + 3 * group, GROUPS.digits[(bits >> (10 * group)) & 0x3FF].data(), 3);
+        }
+    }
+    std::uint32_t bits;
+    std::memcpy(&bits, in + 5 * FULL_BLOCKS, sizeof(bits));
+    for (int group = 0; group < GROUP_COUNT - 4 * FULL_BLOCKS; ++group) {
+        std::memcpy(cells + 12 * FULL_BLOCKS + 3 * group, GROUPS.digits[(bits >> (10 * group)) & 0x3FF].data(), 3);
+    }
+}
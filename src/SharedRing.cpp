@@ -0,0 +1,255 @@
+#include "SharedRing.hpp"
+#include "Generator.hpp"
+#include "Grid.hpp"
+#include "Solver.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    // control word: state in bits 0-7, claims so far in bits 8-15, owner pid in bits 32-63
+    enum State : std::uint64_t { Free, Ready, Claimed, Done };
+
+    State stateOf(std::uint64_t control) { return static_cast<State>(control & 0xFF); }
+    std::uint64_t attemptsOf(std::uint64_t control) { return control >> 8 & 0xFF; }
+    pid_t ownerOf(std::uint64_t control) { return static_cast<pid_t>(control >> 32); }
+
+    std::uint64_t controlWord(State state, std::uint64_t attempts, pid_t owner = 0) {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(owner)) << 32 | attempts << 8 | state;
+    }
+
+    // false on timeout
+    bool waitFor(sem_t* semaphore, int timeoutMillis) {
+        timespec deadline;
+        ::clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += static_cast<long>(timeoutMillis % 1000) * 1000000;
+        deadline.tv_sec += timeoutMillis / 1000 + deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        while (::sem_timedwait(semaphore, &deadline) != 0) {
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+struct alignas(64) SharedRing::Header {
+    std::uint64_t slotCount;
+    std::atomic<std::uint32_t> stopping;
+    sem_t work;    // posted once per slot made ready
+    sem_t done;    // posted once per slot made done
+};
+
+struct alignas(64) SharedRing::Slot {
+    std::atomic<std::uint64_t> control;
+    std::uint64_t sequence;
+    std::uint64_t seed;
+    Job job;
+    Outcome outcome;
+    std::uint8_t option;
+    std::uint8_t cells[Grid::CELL_COUNT];
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "SharedRing needs address free 64 bit atomics");
+
+SharedRing::SharedRing(const std::string& name, std::size_t slots)
+    : name(name[0] == '/' ? name : "/" + name), creator(::getpid()), header(nullptr), slotArray(nullptr),
+      mappedBytes(sizeof(Header) + slots * sizeof(Slot)), submitted(0), collected(0), cursor(0) {
+    static_assert(sizeof(Slot) == 128, "a slot is two cache lines");
+    if (slots == 0) {
+        throw std::invalid_argument("SharedRing::SharedRing - A ring needs at least one slot");
+    }
+
+    ::shm_unlink(this->name.c_str());
+    const int fd = ::shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("SharedRing::SharedRing - Cannot create " + this->name + ": " + std::strerror(errno));
+    }
+    if (::ftruncate(fd, static_cast<off_t>(mappedBytes)) != 0) {
+        const int error = errno;
+        ::close(fd);
+        ::shm_unlink(this->name.c_str());
+        throw std::runtime_error("SharedRing::SharedRing - Cannot size " + this->name + ": " + std::strerror(error));
+    }
+    void* mapped = ::mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        ::shm_unlink(this->name.c_str());
+        throw std::runtime_error("SharedRing::SharedRing - Cannot map " + this->name + ": " + std::strerror(error));
+    }
+
+    header = new (mapped) Header;
+    slotArray = reinterpret_cast<Slot*>(static_cast<char*>(mapped) + sizeof(Header));
+    header->slotCount = slots;
+    header->stopping.store(0, std::memory_order_relaxed);
+    ::sem_init(&header->work, 1, 0);
+    ::sem_init(&header->done, 1, 0);
+    for (std::size_t i = 0; i < slots; ++i) {
+        Slot* slot = new (&slotArray[i]) Slot;
+        slot->control.store(controlWord(Free, 0), std::memory_order_relaxed);
+    }
+}
+
+SharedRing::~SharedRing() {
+    if (::getpid() == creator) {
+        ::sem_destroy(&header->work);
+        ::sem_destroy(&header->done);
+        ::shm_unlink(name.c_str());
+    }
+    ::munmap(header, mappedBytes);
+}
+
+std::size_t SharedRing::slots() const {
+    return static_cast<std::size_t>(header->slotCount);
+}
+
+// cells may be nullptr for Generate
+bool SharedRing::submit(Job job, const std::uint8_t* cells, int option, std::uint64_t seed) {
+    if (inFlight() == slots()) {
+        return false;
+    }
+    Slot& slot = slotArray[submitted % slots()];
+    slot.sequence = submitted;
+    slot.seed = seed;
+    slot.job = job;
+    slot.outcome = Outcome::Pending;
+    slot.option = static_cast<std::uint8_t>(option);
+    if (cells) {
+        std::memcpy(slot.cells, cells, Grid::CELL_COUNT);
+    }
+    slot.control.store(controlWord(Ready, 0), std::memory_order_release);
+    ++submitted;
+    ::sem_post(&header->work);
+    return true;
+}
+
+bool SharedRing::collect(Result& result) {
+    if (collected == submitted) {
+        return false;
+    }
+    Slot& slot = slotArray[collected % slots()];
+    if (stateOf(slot.control.load(std::memory_order_acquire)) != Done) {
+        return false;
+    }
+    result.sequence = slot.sequence;
+    result.job = slot.job;
+    result.outcome = slot.outcome;
+    result.cells = slot.cells;
+    // no worker touches a done slot, the cells stay put until submit reuses it
+    slot.control.store(controlWord(Free, 0), std::memory_order_relaxed);
+    ++collected;
+    return true;
+}
+
+void SharedRing::waitForResults(int timeoutMillis) {
+    waitFor(&header->done, timeoutMillis);
+}
+
+// the owner is gone, so nothing else writes these slots. A claimed Solve slot may hold part of
+// the solution over the puzzle, which is the same puzzle with some of its answer filled in
+std::size_t SharedRing::recover(pid_t worker) {
+    std::size_t recovered = 0;
+    for (std::size_t i = 0; i < slots(); ++i) {
+        Slot& slot = slotArray[i];
+        const std::uint64_t control = slot.control.load(std::memory_order_acquire);
+        if (stateOf(control) != Claimed || ownerOf(control) != worker) {
+            continue;
+        }
+        if (attemptsOf(control) >= MAX_ATTEMPTS) {
+            slot.outcome = Outcome::Failed;
+            slot.control.store(controlWord(Done, attemptsOf(control)), std::memory_order_release);
+            ::sem_post(&header->done);
+        }
+        else {
+            slot.control.store(controlWord(Ready, attemptsOf(control)), std::memory_order_release);
+            ::sem_post(&header->work);
+        }
+        ++recovered;
+    }
+    return recovered;
+}
+
+void SharedRing::stop() {
+    header->stopping.store(1, std::memory_order_release);
+    ::sem_post(&header->work);
+}
+
+bool SharedRing::serveOne() {
+    const pid_t self = ::getpid();
+    for (std::size_t scanned = 0; scanned < slots(); ++scanned) {
+        const std::size_t index = (cursor + scanned) % slots();
+        Slot& slot = slotArray[index];
+        std::uint64_t control = slot.control.load(std::memory_order_relaxed);
+        if (stateOf(control) != Ready) {
+            continue;
+        }
+        const std::uint64_t claimed = controlWord(Claimed, attemptsOf(control) + 1, self);
+        if (!slot.control.compare_exchange_strong(control, claimed, std::memory_order_acquire, std::memory_order_relaxed)) {
+            continue;
+        }
+        cursor = index + 1;
+        execute(slot);
+        slot.control.store(controlWord(Done, attemptsOf(claimed)), std::memory_order_release);
+        ::sem_post(&header->done);
+        return true;
+    }
+    return false;
+}
+
+void SharedRing::run() {
+    for (;;) {
+        if (serveOne()) {
+            continue;
+        }
+        if (header->stopping.load(std::memory_order_acquire)) {
+            ::sem_post(&header->work); // passes the wakeup on to the next worker
+            return;
+        }
+        waitFor(&header->work, 50);
+    }
+}
+
+void SharedRing::execute(Slot& slot) {
+    try {
+        switch (slot.job) {
+            case Job::Solve: {
+                Grid grid;
+                grid.loadFromCells(slot.cells);
+                if (Solver::solve(grid, static_cast<Solver::Strategy>(slot.option)) && grid.isComplete()) {
+                    std::memcpy(slot.cells, grid.getCells().data(), Grid::CELL_COUNT);
+                    slot.outcome = Outcome::Solved;
+                }
+                else {
+                    slot.outcome = Outcome::Unsolvable;
+                }
+                break;
+            }
+            case Job::Unique: {
+                Grid grid;
+                grid.loadFromCells(slot.cells);
+                const int solutions = Solver::countSolutions(grid, 2);
+                slot.outcome = solutions == 1 ? Outcome::Unique : solutions == 0 ? Outcome::Unsolvable : Outcome::NotUnique;
+                break;
+            }
+            case Job::Generate: {
+                Generator generator{slot.seed};  // braces: a narrower seed parameter would not compile
+                const Grid puzzle = generator.generate(static_cast<GeneratorDifficulty>(slot.option));
+                std::memcpy(slot.cells, puzzle.getCells().data(), Grid::CELL_COUNT);
+                slot.outcome = Outcome::Generated;
+                break;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        slot.outcome = Outcome::Failed;
+    }
+}
@@ -0,0 +1,243 @@
+#include "SolutionCache.hpp"
+#include "PuzzleDatabase.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr int PACKED = PuzzleDatabase::CELL_BYTES;
+
+    enum class Solved : std::uint8_t { Unknown, Yes, No };
+    enum class Verdict : std::uint8_t { Unknown, Unique, NotUnique };
+
+    std::uint64_t mix(std::uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ull;
+        x ^= x >> 33;
+        return x;
+    }
+}
+
+struct SolutionCache::Key {
+    std::uint8_t cells[PACKED];
+    std::uint64_t hash;
+
+    explicit Key(const Grid& grid) {
+        PuzzleDatabase::encode(grid.getCells().data(), cells);
+        hash = 0x9E3779B97F4A7C15ull;
+        for (int at = 0; at < PACKED; at += 8) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, cells + at, std::min(8, PACKED - at));
+            hash = mix(hash ^ word);
+        }
+    }
+
+    std::uint32_t tag() const { return static_cast<std::uint32_t>(hash >> 20) | 1; } // 0 marks a free way
+};
+
+struct SolutionCache::Entry {
+    std::uint8_t cells[PACKED];
+    std::uint8_t solution[PACKED];
+    Solved solved;
+    Verdict verdict;
+};
+
+struct SolutionCache::Bucket {
+    std::uint32_t tags[WAYS];
+    std::uint8_t referenced;   // bit w set -> way w was hit since the hand last passed it
+    std::uint8_t hand;
+    Entry entries[WAYS];
+
+    Entry* find(const Key& key) {
+        const std::uint32_t tag = key.tag();
+        for (int way = 0; way < WAYS; ++way) {
+            if (tags[way] == tag && std::memcmp(entries[way].cells, key.cells, PACKED) == 0) {
+                referenced |= static_cast<std::uint8_t>(1u << way);
+                return &entries[way];
+            }
+        }
+        return nullptr;
+    }
+
+    // the entry for key, taking a free way or the CLOCK victim when it is not there yet
+    Entry& findOrInsert(const Key& key, std::uint64_t& evictions) {
+        if (Entry* entry = find(key)) {
+            return *entry;
+        }
+        int way = 0;
+        while (way < WAYS && tags[way] != 0) {
+            ++way;
+        }
+        if (way == WAYS) {
+            while (referenced >> hand & 1) {
+                referenced = static_cast<std::uint8_t>(referenced & ~(1u << hand));
+                hand = static_cast<std::uint8_t>((hand + 1) % WAYS);
+            }
+            way = hand;
+            hand = static_cast<std::uint8_t>((hand + 1) % WAYS);
+            ++evictions;
+        }
+        tags[way] = key.tag();
+        Entry& entry = entries[way];
+        std::memcpy(entry.cells, key.cells, PACKED);
+        entry.solved = Solved::Unknown;
+        entry.verdict = Verdict::Unknown;
+        return entry;
+    }
+};
+
+struct alignas(64) SolutionCache::Shard {
+    std::mutex mutex;
+    std::unique_ptr<Bucket[]> buckets;
+    Counters counters;
+};
+
+SolutionCache::SolutionCache(std::size_t maxBytes) : shards(new Shard[SHARD_COUNT]), bucketsPerShard(1) {
+    while (2 * bucketsPerShard * SHARD_COUNT * sizeof(Bucket) <= maxBytes) {
+        bucketsPerShard *= 2;
+    }
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        shards[i].buckets.reset(new Bucket[bucketsPerShard]);
+    }
+    clear();
+}
+
+SolutionCache::~SolutionCache() = default;
+
+bool SolutionCache::solve(Grid& grid, Solver::Strategy strategy) {
+    const Key key(grid);
+    Shard& shard = shardFor(key);
+    if (strategy == Solver::Strategy::HUMAN || !standardCandidates(grid)) {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            ++shard.counters.bypassed;
+        }
+        return Solver::solve(grid, strategy);
+    }
+
+    Bucket& bucket = bucketFor(shard, key);
+    Solved solved = Solved::Unknown;
+    std::uint8_t packed[PACKED];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const Entry* entry = bucket.find(key);
+        if (entry && entry->solved != Solved::Unknown) {
+            solved = entry->solved;
+            std::memcpy(packed, entry->solution, PACKED);
+            ++shard.counters.hits;
+        }
+        else {
+            ++shard.counters.misses;
+        }
+    }
+
+    if (solved != Solved::Unknown) {
+        if (solved == Solved::No) {
+            return false;
+        }
+        std::uint8_t cells[Grid::CELL_COUNT];
+        PuzzleDatabase::decode(packed, cells);
+        grid.completeWithSolution(cells);
+        return true;
+    }
+
+    // every strategy but HUMAN is a complete search, so failing means there is no solution
+    const bool found = Solver::solve(grid, strategy);
+    if (found) {
+        PuzzleDatabase::encode(grid.getCells().data(), packed);
+    }
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Entry& entry = bucket.findOrInsert(key, shard.counters.evictions);
+    entry.solved = found ? Solved::Yes : Solved::No;
+    if (found) {
+        std::memcpy(entry.solution, packed, PACKED);
+    }
+    else {
+        entry.verdict = Verdict::NotUnique;
+    }
+    return found;
+}
+
+bool SolutionCache::hasUniqueSolution(const Grid& grid) {
+    const Key key(grid);
+    Shard& shard = shardFor(key);
+    if (!standardCandidates(grid)) {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            ++shard.counters.bypassed;
+        }
+        return Solver::hasUniqueSolution(grid);
+    }
+
+    Bucket& bucket = bucketFor(shard, key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const Entry* entry = bucket.find(key);
+        if (entry && entry->verdict != Verdict::Unknown) {
+            ++shard.counters.hits;
+            return entry->verdict == Verdict::Unique;
+        }
+        ++shard.counters.misses;
+    }
+
+    const int solutions = Solver::countSolutions(grid);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Entry& entry = bucket.findOrInsert(key, shard.counters.evictions);
+    entry.verdict = solutions == 1 ? Verdict::Unique : Verdict::NotUnique;
+    if (solutions == 0) {
+        entry.solved = Solved::No;
+    }
+    return solutions == 1;
+}
+
+SolutionCache::Counters SolutionCache::counters() const {
+    Counters total;
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        total.hits += shards[i].counters.hits;
+        total.misses += shards[i].counters.misses;
+        total.evictions += shards[i].counters.evictions;
+        total.bypassed += shards[i].counters.bypassed;
+    }
+    return total;
+}
+
+std::size_t SolutionCache::capacity() const {
+    return SHARD_COUNT * bucketsPerShard * WAYS;
+}
+
+// drops every entry, counters are kept
+void SolutionCache::clear() {
+    for (int i = 0; i < SHARD_COUNT; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        for (std::size_t b = 0; b < bucketsPerShard; ++b) {
+            Bucket& bucket = shards[i].buckets[b];
+            std::memset(bucket.tags, 0, sizeof(bucket.tags));
+            bucket.referenced = 0;
+            bucket.hand = 0;
+        }
+    }
+}
+
+// what updateAllCandidates would give: every digit no peer holds
+bool SolutionCache::standardCandidates(const Grid& grid) {
+    // runs on every call, hits included, so it avoids a branch per cell
+    bool edited = false;
+    for (int row = 0; row < Grid::GRID_SIZE; ++row) {
+        for (int col = 0; col < Grid::GRID_SIZE; ++col) {
+            const int index = row * Grid::GRID_SIZE + col;
+            const Grid::Mask used = grid.getRowMask(row) | grid.getColumnMask(col) | grid.getBoxMask(Grid::getBoxIndex(row, col));
+            edited |= (grid.cellValue(index) == Grid::EMPTY) & (grid.cellCandidates(index) != (Grid::ALL_MASK & ~used));
+        }
+    }
+    return !edited;
+}
+
+SolutionCache::Shard& SolutionCache::shardFor(const Key& key) const {
+    return shards[key.hash >> (64 - SHARD_BITS)];
+}
+
+SolutionCache::Bucket& SolutionCache::bucketFor(Shard& shard, const Key& key) const {
+    return shard.buckets[key.hash & (bucketsPerShard - 1)];
+}
@@ -1,274 +1,776 @@
 #include "Solver.hpp"
+#include "DancingLinks.hpp"
+#include "BandSolver.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
 
-bool Solver::solve(Grid& grid, Strategy strategy) {
-    const std::vector<std::function<bool(Grid&)>> techniques = {
-        nakedSingles,   
-        hiddenSingles,
-        nakedPairs,
-        // solvePointingPairs,
-        // solveBoxLineReduction,
-        // solveXWing,
-        // solveSwordfish
+namespace {
+    // shared by the recursive searches, placements are undone by rolling back to a checkpoint
+    template <int BoxSize>
+    typename BasicGrid<BoxSize>::Trail& searchTrail() {
+        thread_local typename BasicGrid<BoxSize>::Trail trail;
+        return trail;
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    // statistics hooks for the templated solve paths, every NoStats call compiles away
+    struct NoStats {
+        static constexpr bool enabled = false;
+        void node(int) {}
+        void backtrack() {}
+        void propagated() {}
+        bool exhausted() { return false; }
     };
 
-    if (strategy != Strategy::BRUTE_FORCE) {
-        bool changed;
-        do {
-            changed = false;
-            for (const auto& technique : techniques) {
-                changed = changed || technique(grid);
-                if (grid.isComplete()) {
-                    return true;
-                }
+    // no statistics, the search gives up after `nodesLeft` nodes
+    struct NodeBudget : NoStats {
+        std::uint64_t nodesLeft;
+
+        explicit NodeBudget(std::uint64_t nodes) : nodesLeft(nodes) {}
+        bool exhausted() {
+            if (nodesLeft == 0) {
+                return true;
+            }
+            --nodesLeft;
+            return false;
+        }
+    };
+
+    struct CollectStats {
+        static constexpr bool enabled = true;
+        SolverStats& stats;
+
+        void node(int depth) {
+            ++stats.nodes;
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+        }
+        void backtrack() { ++stats.backtracks; }
+        void propagated() { ++stats.propagations; }
+        bool exhausted() { return false; }
+    };
+
+    // no statistics, the search stops at a deadline, after a node budget or once a token is
+    // cancelled, and remembers which. The clock is read every CLOCK_NODES nodes
+    struct Bounded : NoStats {
+        static constexpr std::uint64_t CLOCK_NODES = 16;
+
+        Clock::time_point deadline;
+        std::uint64_t nodeBudget;
+        const CancellationToken& cancel;
+        std::uint64_t nodes = 0;
+        int maxDepth = 0;
+        bool stopped = false;
+        SolveStatus reason = SolveStatus::CANCELLED;
+
+        Bounded(Clock::time_point deadline, std::uint64_t nodeBudget, const CancellationToken& cancel)
+            : deadline(deadline), nodeBudget(nodeBudget), cancel(cancel) {}
+
+        void node(int depth) {
+            ++nodes;
+            maxDepth = std::max(maxDepth, depth);
+        }
+        bool exhausted() {
+            if (stopped) {
+                return true;
+            }
+            if (cancel.cancelled()) {
+                reason = SolveStatus::CANCELLED;
+            }
+            else if (nodeBudget && nodes > nodeBudget) {
+                reason = SolveStatus::OUT_OF_NODES;
+            }
+            else if (nodes % CLOCK_NODES == 1 && Clock::now() >= deadline) {
+                reason = SolveStatus::OUT_OF_TIME;
+            }
+            else {
+                return false;
+            }
+            stopped = true;
+            return true;
+        }
+    };
+
+    ThreadPool& asyncPool() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    std::uint64_t nanosSince(Clock::time_point start) {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    template <typename G>
+    int totalCandidates(const G& grid) {
+        int total = 0;
+        for (typename G::Mask mask : grid.getCandidateMasks()) {
+            total += G::countCandidates(mask);
+        }
+        return total;
+    }
+
+    template <typename G>
+    constexpr typename G::UnitSet ROW_UNITS = (typename G::UnitSet(1) << G::GRID_SIZE) - 1;
+    template <typename G>
+    constexpr typename G::UnitSet LINE_UNITS = (typename G::UnitSet(1) << (2 * G::GRID_SIZE)) - 1; // rows and columns
+
+    // slices of a box or line other than `skip`, OR-ed together
+    template <typename Mask, std::size_t Count>
+    Mask unionOfOthers(const Mask (&slices)[Count], int skip) {
+        Mask others = 0;
+        for (int i = 0; i < static_cast<int>(Count); ++i) {
+            if (i != skip) {
+                others |= slices[i];
             }
-        } 
-        while (changed);
+        }
+        return others;
+    }
+
+    constexpr SolverStrategy ALL_STRATEGIES[] = {
+        SolverStrategy::BRUTE_FORCE,
+        SolverStrategy::HUMAN,
+        SolverStrategy::HYBRID,
+        SolverStrategy::DLX,
+        SolverStrategy::BITBOARD
+    };
+}
+
+template <int BoxSize>
+bool BasicSolver<BoxSize>::solve(Grid& grid, Strategy strategy) {
+    NoStats stats;
+    return solveWith(grid, strategy, stats);
+}
+
+template <int BoxSize>
+bool BasicSolver<BoxSize>::solve(Grid& grid, Strategy strategy, SolverStats& stats) {
+    const Clock::time_point start = Clock::now();
+    CollectStats collect{stats};
+    const bool solved = solveWith(grid, strategy, collect);
+    ++stats.solveCalls;
+    stats.nanos += nanosSince(start);
+    return solved;
+}
+
+template <int BoxSize>
+template <typename Stats>
+bool BasicSolver<BoxSize>::solveWith(Grid& grid, Strategy strategy, Stats& stats) {
+    if constexpr (BoxSize == 3) {
+        if (strategy == Strategy::DLX) {
+            return DancingLinks::forThisThread().solve(grid, 1, &grid) == 1;
+        }
+        if (strategy == Strategy::BITBOARD) {
+            return BandSolver::solve(grid, 1, &grid) == 1;
+        }
+    }
+    else if (strategy == Strategy::DLX || strategy == Strategy::BITBOARD) {
+        return bruteForce(grid, stats);
+    }
+
+    if (strategy != Strategy::BRUTE_FORCE && applyTechniques(grid, stats)) {
+        return true;
     }
 
     if (strategy == Strategy::HYBRID || strategy == Strategy::BRUTE_FORCE) {
-        return bruteForce(grid, 0 ,0);
+        return bruteForce(grid, stats);
     }
 
-    return grid.isComplete();
+    return false;
 }
 
-bool Solver::hasUniqueSolution(const Grid& grid) {
-    Grid temp = grid;
-    int count = countSolutions(temp, 0, 0);
-    return count == 1;
+template <int BoxSize>
+const char* BasicSolver<BoxSize>::strategyName(Strategy strategy) {
+    switch (strategy) {
+        case Strategy::BRUTE_FORCE: return "brute";
+        case Strategy::HUMAN:       return "human";
+        case Strategy::HYBRID:      return "hybrid";
+        case Strategy::DLX:         return "dlx";
+        case Strategy::BITBOARD:    return "bitboard";
+    }
+    return "unknown";
 }
 
-int Solver::countSolutions(Grid& grid, int row, int col) {
-    constexpr int MAX_SOLUTIONS_NEEDED = 2; 
-    
-    if (row == Grid::GRID_SIZE) {
-        return 1; 
+template <int BoxSize>
+bool BasicSolver<BoxSize>::parseStrategy(const std::string& name, Strategy& strategy) {
+    for (Strategy candidate : ALL_STRATEGIES) {
+        if (name == strategyName(candidate)) {
+            strategy = candidate;
+            return true;
+        }
     }
-    
-    if (col == Grid::GRID_SIZE) {
-        return countSolutions(grid, row + 1, 0); 
+    return false;
+}
+
+template <int BoxSize>
+const char* BasicSolver<BoxSize>::statusName(SolveStatus status) {
+    switch (status) {
+        case SolveStatus::SOLVED:             return "solved";
+        case SolveStatus::UNSOLVABLE:         return "unsolvable";
+        case SolveStatus::MULTIPLE_SOLUTIONS: return "multiple";
+        case SolveStatus::OUT_OF_TIME:        return "timeout";
+        case SolveStatus::OUT_OF_NODES:       return "node-limit";
+        case SolveStatus::CANCELLED:          return "cancelled";
     }
-    
-    if (grid.get(row, col) != Grid::EMPTY) {
-        return countSolutions(grid, row, col + 1); 
+    return "unknown";
+}
+
+template <int BoxSize>
+bool BasicSolver<BoxSize>::hasUniqueSolution(const Grid& grid) {
+    return countSolutions(grid) == 1;
+}
+
+template <int BoxSize>
+int BasicSolver<BoxSize>::countSolutions(const Grid& grid, int limit) {
+    NoStats stats;
+    return countWith(grid, limit, stats);
+}
+
+template <int BoxSize>
+int BasicSolver<BoxSize>::countSolutions(const Grid& grid, int limit, SolverStats& stats) {
+    const Clock::time_point start = Clock::now();
+    CollectStats collect{stats};
+    const int count = countWith(grid, limit, collect);
+    ++stats.countSolutionsCalls;
+    stats.nanos += nanosSince(start);
+    return count;
+}
+
+template <int BoxSize>
+int BasicSolver<BoxSize>::countSolutionsWithin(const Grid& grid, int limit, std::uint64_t nodeBudget) {
+    if (nodeBudget == 0) {
+        return countSolutions(grid, limit);
     }
-    
-    int total = 0;
-    for (int num = 1; num <= Grid::GRID_SIZE && total < MAX_SOLUTIONS_NEEDED; ++num) {
-        if (canPlace(grid, row, col, num)) {
-            grid.set(row, col, num);
-            total += countSolutions(grid, row, col + 1);
-            grid.set(row, col, Grid::EMPTY);
+    NodeBudget stats(nodeBudget);
+    return countWith(grid, limit, stats);
+}
+
+template <int BoxSize>
+template <typename Stats>
+int BasicSolver<BoxSize>::countWith(const Grid& grid, int limit, Stats& stats) {
+    if (limit <= 0 || !grid.isValid()) {
+        return 0;
+    }
+    Grid temp = grid;
+    Trail& trail = searchTrail<BoxSize>();
+    const std::size_t mark = trail.checkpoint();
+    const int count = search(temp, trail, limit, nullptr, stats, 0);
+    temp.rollback(trail, mark);
+    return count;
+}
+
+template <int BoxSize>
+int BasicSolver<BoxSize>::countSolutionsUpTo(const Grid& grid, int limit, Strategy strategy) {
+    if constexpr (BoxSize == 3) {
+        if (strategy == Strategy::DLX) {
+            return DancingLinks::forThisThread().solve(grid, limit);
+        }
+        if (strategy == Strategy::BITBOARD) {
+            return BandSolver::solve(grid, limit);
         }
     }
-    return total;
+    return countSolutions(grid, limit);
 }
 
-bool Solver::bruteForce(Grid& grid, int row = 0, int col = 0) {
-    if (row == Grid::GRID_SIZE) {
-        return true;
+template <int BoxSize>
+bool BasicSolver<BoxSize>::hasSolutionWithout(const Grid& grid, int row, int col, int digit, std::uint64_t nodeBudget) {
+    if (!grid.isValid()) {
+        return false;
+    }
+    Grid temp = grid;
+    temp.setCandidateMask(row, col, temp.getCandidateMask(row, col) & ~Grid::digitMask(digit));
+    Trail& trail = searchTrail<BoxSize>();
+    const std::size_t mark = trail.checkpoint();
+    int found;
+    if (nodeBudget == 0) {
+        NoStats stats;
+        found = search(temp, trail, 1, nullptr, stats, 0);
+    }
+    else {
+        NodeBudget stats(nodeBudget);
+        found = search(temp, trail, 1, nullptr, stats, 0);
     }
+    temp.rollback(trail, mark);
+    return found == 1;
+}
 
-    if (col == Grid::GRID_SIZE) {
-        return bruteForce(grid, row + 1, 0);
+template <int BoxSize>
+template <typename Stats>
+bool BasicSolver<BoxSize>::bruteForce(Grid& grid, Stats& stats) {
+    if (!grid.isValid()) {
+        return false;
     }
-    
-    if (grid.get(row, col) != Grid::EMPTY) {
-        return bruteForce(grid, row, col + 1);
+    Grid solution;
+    Trail& trail = searchTrail<BoxSize>();
+    const std::size_t mark = trail.checkpoint();
+    const bool solved = search(grid, trail, 1, &solution, stats, 0) == 1;
+    grid.rollback(trail, mark);
+    if (solved) {
+        grid = solution;
     }
+    return solved;
+}
 
-    for (int num = 1; num <= Grid::GRID_SIZE; ++num) {
-        if (canPlace(grid, row, col, num)) {
-            grid.set(row, col, num);
-            if (bruteForce(grid, row, col + 1)) {
-                return true;
-            }
-            grid.set(row, col, Grid::EMPTY);
+template <int BoxSize>
+template <typename Stats>
+int BasicSolver<BoxSize>::search(Grid& grid, Trail& trail, int limit, Grid* firstSolution, Stats& stats, int depth) {
+    stats.node(depth);
+    if (stats.exhausted()) {
+        return limit; // out of budget, callers read this as "too many solutions"
+    }
+    if (!propagate(grid, trail, stats)) {
+        stats.backtrack();
+        return 0;
+    }
+
+    const int branchCell = chooseBranchCell(grid);
+    if (branchCell < 0) {
+        if (firstSolution) {
+            *firstSolution = grid;
         }
+        return 1;
     }
-    return false;
+
+    const std::size_t mark = trail.checkpoint();
+    int total = 0;
+    for (Mask options = grid.cellCandidates(branchCell); options && total < limit; options &= options - 1) {
+        grid.place(branchCell, Grid::lowestDigit(options), trail);
+        total += search(grid, trail, limit - total, total == 0 ? firstSolution : nullptr, stats, depth + 1);
+        grid.rollback(trail, mark);
+    }
+    return total;
 }
 
-bool Solver::nakedSingles(Grid& grid) {
-    bool changed = false;
-    for (int row = 0; row < Grid::GRID_SIZE; ++row) {
-        for (int col = 0; col < Grid::GRID_SIZE; ++col) {
-            const std::set<int> &cand = grid.getCandidates(row, col);
-            if (cand.size() == 1) {
-                grid.set(row, col, *cand.begin());
-                changed = true;
+// empty cell with the fewest candidates, -1 once the grid is full
+template <int BoxSize>
+int BasicSolver<BoxSize>::chooseBranchCell(const Grid& grid) {
+    int branchCell = -1;
+    int fewest = Grid::GRID_SIZE + 1;
+    for (int index = 0; index < Grid::CELL_COUNT && fewest > 2; ++index) {
+        if (grid.cellValue(index) == Grid::EMPTY) {
+            const int count = Grid::countCandidates(grid.cellCandidates(index));
+            if (count < fewest) {
+                fewest = count;
+                branchCell = index;
             }
         }
     }
-    return changed;
+    return branchCell;
 }
 
-bool Solver::hiddenSingles(Grid& grid) {
-    bool changed = false;
-    
-    for (int row = 0; row < Grid::GRID_SIZE; ++row) {
-        std::unordered_map<int, std::vector<int>> numPositions; 
-        
-        for (int col = 0; col < Grid::GRID_SIZE; ++col) {
-            if (grid.get(row, col) == Grid::EMPTY) {
-                for (int num : grid.getCandidates(row, col)) {
-                    numPositions[num].push_back(col);
-                }
-            }
+template <int BoxSize>
+struct BasicSolver<BoxSize>::ParallelSearch {
+    static constexpr int MAX_SPLIT_DEPTH = 24; // deeper subtrees are too small to be worth a task
+
+    ThreadPool& pool;
+    const CountOptions& options;
+    std::atomic<std::uint64_t> found{0};
+    std::atomic<bool> stop{false};
+    std::mutex callbackMutex;
+
+    ParallelSearch(ThreadPool& pool, const CountOptions& options) : pool(pool), options(options) {}
+
+    void report(const Grid& solution) {
+        const std::uint64_t count = found.fetch_add(1) + 1;
+        if (options.limit && count > options.limit) {
+            return;
         }
-        
-        for (const auto& [num, cols] : numPositions) {
-            if (cols.size() == 1) {
-                int col = cols[0];
-                if (grid.get(row, col) == Grid::EMPTY) {
-                    grid.set(row, col, num);
-                    changed = true;
-                }
-            }
+        if (options.onSolution) {
+            std::lock_guard<std::mutex> lock(callbackMutex);
+            options.onSolution(solution);
+        }
+        if (options.limit && count >= options.limit) {
+            stop.store(true);
         }
     }
+};
 
-    for (int col = 0; col < Grid::GRID_SIZE; ++col) {
-        std::unordered_map<int, std::vector<int>> numPositions; 
-        
-        for (int row = 0; row < Grid::GRID_SIZE; ++row) {
-            if (grid.get(row, col) == Grid::EMPTY) {
-                for (int num : grid.getCandidates(row, col)) {
-                    numPositions[num].push_back(row);
-                }
-            }
+template <int BoxSize>
+std::uint64_t BasicSolver<BoxSize>::countSolutionsParallel(const Grid& grid, const CountOptions& options) {
+    if (!grid.isValid()) {
+        return 0;
+    }
+
+    ThreadPool pool(options.threads);
+    ParallelSearch shared(pool, options);
+    pool.submit([&shared, root = grid]() mutable {
+        Trail& trail = searchTrail<BoxSize>();
+        const std::size_t mark = trail.checkpoint();
+        searchParallel(root, trail, shared, 0);
+        root.rollback(trail, mark);
+    });
+    pool.waitIdle();
+
+    const std::uint64_t found = shared.found.load();
+    return options.limit ? std::min(found, options.limit) : found;
+}
+
+template <int BoxSize>
+std::uint64_t BasicSolver<BoxSize>::countSolutionsParallel(const Grid& grid) {
+    return countSolutionsParallel(grid, CountOptions());
+}
+
+// same search as above, alternatives at shallow nodes become pool tasks while a worker is idle
+template <int BoxSize>
+void BasicSolver<BoxSize>::searchParallel(Grid& grid, Trail& trail, ParallelSearch& shared, int depth) {
+    NoStats stats;
+    if (shared.stop.load(std::memory_order_relaxed) || !propagate(grid, trail, stats)) {
+        return;
+    }
+
+    const int branchCell = chooseBranchCell(grid);
+    if (branchCell < 0) {
+        shared.report(grid);
+        return;
+    }
+
+    const std::size_t mark = trail.checkpoint();
+    for (Mask options = grid.cellCandidates(branchCell); options; options &= options - 1) {
+        if (shared.stop.load(std::memory_order_relaxed)) {
+            return;
         }
-        
-        for (const auto& [num, rows] : numPositions) {
-            if (rows.size() == 1) {
-                int row = rows[0];
-                if (grid.get(row, col) == Grid::EMPTY) {
-                    grid.set(row, col, num);
-                    changed = true;
-                }
-            }
+        const int digit = Grid::lowestDigit(options);
+        const bool lastOption = (options & (options - 1)) == 0;
+
+        if (!lastOption && depth < ParallelSearch::MAX_SPLIT_DEPTH && shared.pool.hasIdleWorkers()) {
+            shared.pool.submit([&shared, child = grid, branchCell, digit, depth]() mutable {
+                Trail& taskTrail = searchTrail<BoxSize>();
+                const std::size_t taskMark = taskTrail.checkpoint();
+                child.place(branchCell, digit, taskTrail);
+                searchParallel(child, taskTrail, shared, depth + 1);
+                child.rollback(taskTrail, taskMark);
+            });
+            continue;
         }
+
+        grid.place(branchCell, digit, trail);
+        searchParallel(grid, trail, shared, depth + 1);
+        grid.rollback(trail, mark);
     }
+}
 
-    for (int boxRow = 0; boxRow < Grid::GRID_SIZE; boxRow += Grid::SUBGRID_SIZE) {
-        for (int boxCol = 0; boxCol < Grid::GRID_SIZE; boxCol += Grid::SUBGRID_SIZE) {
-            std::unordered_map<int, std::pair<int, int>> numPositions; 
-            
-            for (int r = 0; r < Grid::SUBGRID_SIZE; ++r) {
-                for (int c = 0; c < Grid::SUBGRID_SIZE; ++c) {
-                    int row = boxRow + r;
-                    int col = boxCol + c;
-                    
-                    if (grid.get(row, col) == Grid::EMPTY) {
-                        for (int num : grid.getCandidates(row, col)) {
-                            numPositions[num] = {row, col};
-                        }
-                    }
-                }
+template <int BoxSize>
+typename BasicSolver<BoxSize>::BoundedResult BasicSolver<BoxSize>::solveWithin(const Grid& grid, const Limits& limits) {
+    const Clock::time_point deadline = limits.timeLimit.count() > 0 ? Clock::now() + limits.timeLimit : Clock::time_point::max();
+    return solveUntil(grid, limits, deadline);
+}
+
+template <int BoxSize>
+std::future<typename BasicSolver<BoxSize>::BoundedResult> BasicSolver<BoxSize>::solveAsync(const Grid& grid, const Limits& limits) {
+    const Clock::time_point deadline = limits.timeLimit.count() > 0 ? Clock::now() + limits.timeLimit : Clock::time_point::max();
+    // std::function needs a copyable task, so the packaged task is shared
+    auto task = std::make_shared<std::packaged_task<BoundedResult()>>([grid, limits, deadline] {
+        return solveUntil(grid, limits, deadline);
+    });
+    std::future<BoundedResult> result = task->get_future();
+    asyncPool().submit([task] { (*task)(); });
+    return result;
+}
+
+template <int BoxSize>
+typename BasicSolver<BoxSize>::BoundedResult BasicSolver<BoxSize>::solveUntil(const Grid& grid, const Limits& limits,
+                                                                              std::chrono::steady_clock::time_point deadline) {
+    const Clock::time_point start = Clock::now();
+    BoundedResult result;
+    if (!grid.isValid()) {
+        return result;
+    }
+
+    Bounded bounded(deadline, limits.nodeBudget, limits.cancel);
+    Grid temp = grid;
+    Trail& trail = searchTrail<BoxSize>();
+    const std::size_t mark = trail.checkpoint();
+    const int found = search(temp, trail, MAX_SOLUTIONS_NEEDED, &result.solution, bounded, 0);
+    temp.rollback(trail, mark);
+
+    // a stopped search returns its limit, whether it got as far as one solution shows in the grid
+    result.solutionsFound = bounded.stopped ? (result.solution.isComplete() ? 1 : 0) : found;
+    if (bounded.stopped) {
+        result.status = bounded.reason;
+    }
+    else {
+        result.status = found == 0 ? SolveStatus::UNSOLVABLE : found == 1 ? SolveStatus::SOLVED : SolveStatus::MULTIPLE_SOLUTIONS;
+    }
+    result.nodes = bounded.nodes - (bounded.stopped ? 1 : 0); // the node that hit a limit was not searched
+    result.maxDepth = bounded.maxDepth;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+// naked and hidden singles until nothing changes, false once a cell or a digit has no place left
+template <int BoxSize>
+template <typename Stats>
+bool BasicSolver<BoxSize>::propagate(Grid& grid, Trail& trail, Stats& stats) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+            if (grid.cellValue(index) != Grid::EMPTY) {
+                continue;
             }
-            
-            std::unordered_map<int, int> numCounts;
-            for (int r = 0; r < Grid::SUBGRID_SIZE; ++r) {
-                for (int c = 0; c < Grid::SUBGRID_SIZE; ++c) {
-                    int row = boxRow + r;
-                    int col = boxCol + c;
-                    
-                    if (grid.get(row, col) == Grid::EMPTY) {
-                        for (int num : grid.getCandidates(row, col)) {
-                            numCounts[num]++;
-                        }
-                    }
-                }
+            const Mask cand = grid.cellCandidates(index);
+            if (cand == 0) {
+                return false;
+            }
+            if ((cand & (cand - 1)) == 0) {
+                grid.place(index, Grid::lowestDigit(cand), trail);
+                stats.propagated();
+                changed = true;
+            }
+        }
+
+        for (int unit = 0; unit < Grid::UNIT_COUNT; ++unit) {
+            const auto& cells = Grid::unitCells(unit);
+            Mask once = 0;
+            Mask twice = 0;
+            for (const Index index : cells) {
+                const Mask cand = grid.cellCandidates(index);
+                twice |= once & cand;
+                once |= cand;
+            }
+            if ((once | grid.getUnitMask(unit)) != Grid::ALL_MASK) {
+                return false;
             }
-            
-            for (const auto& [num, count] : numCounts) {
-                if (count == 1) {
-                    auto [row, col] = numPositions[num];
-                    if (grid.get(row, col) == Grid::EMPTY) {
-                        grid.set(row, col, num);
+
+            for (Mask hidden = once & ~twice; hidden; hidden &= hidden - 1) {
+                const Mask bit = hidden & -hidden;
+                for (const Index index : cells) {
+                    if (grid.cellCandidates(index) & bit) {
+                        grid.place(index, Grid::lowestDigit(bit), trail);
+                        stats.propagated();
                         changed = true;
+                        break;
                     }
                 }
             }
         }
     }
+    return true;
+}
 
-    return changed;
+// cheapest first, the scheduler falls back to a later technique only when every earlier one is stuck
+template <int BoxSize>
+const typename BasicSolver<BoxSize>::Technique BasicSolver<BoxSize>::TECHNIQUES[TECHNIQUE_COUNT] = {
+    nakedSingles,
+    hiddenSingles,
+    nakedPairs,
+    pointingPairs,
+    boxLineReduction,
+    xWing,
+    swordfish
+};
+
+template <int BoxSize>
+bool BasicSolver<BoxSize>::applyTechnique(Grid& grid, int technique, UnitSet units) {
+    if (technique < 0 || technique >= TECHNIQUE_COUNT) {
+        throw std::out_of_range("Solver::applyTechnique - Technique index out of range");
+    }
+    return TECHNIQUES[technique](grid, units);
 }
 
-bool Solver::nakedPairs(Grid& grid) {
+// Every technique keeps the set of units that changed since it last looked at them and only
+// rescans those. A technique that makes progress hands the units it touched to all techniques
+// and the loop restarts from the cheapest one. true once the grid is complete
+template <int BoxSize>
+template <typename Stats>
+bool BasicSolver<BoxSize>::applyTechniques(Grid& grid, Stats& stats) {
+    UnitSet pending[TECHNIQUE_COUNT];
+    std::fill(std::begin(pending), std::end(pending), Grid::ALL_UNITS);
+    grid.takeDirtyUnits();
+
+    int next = 0;
+    while (next < TECHNIQUE_COUNT && grid.filledCount() < Grid::CELL_COUNT) {
+        const UnitSet units = pending[next];
+        if (units == 0) {
+            ++next;
+            continue;
+        }
+        pending[next] = 0;
+
+        bool progress;
+        if constexpr (Stats::enabled) {
+            const int filledBefore = grid.filledCount();
+            const int candidatesBefore = totalCandidates(grid);
+            const Clock::time_point start = Clock::now();
+            progress = TECHNIQUES[next](grid, units);
+
+            SolverStats::Technique& technique = stats.stats.techniques[next];
+            technique.nanos += nanosSince(start);
+            ++technique.runs;
+            technique.placements += static_cast<std::uint64_t>(grid.filledCount() - filledBefore);
+            technique.eliminations += static_cast<std::uint64_t>(candidatesBefore - totalCandidates(grid));
+        }
+        else {
+            progress = TECHNIQUES[next](grid, units);
+        }
+        if (const UnitSet dirty = grid.takeDirtyUnits()) {
+            for (UnitSet& set : pending) {
+                set |= dirty;
+            }
+        }
+        if (progress) {
+            next = 0;
+        }
+    }
+    return grid.isComplete();
+}
+
+// a changed cell dirties its row, so the dirty rows cover every cell worth looking at
+template <int BoxSize>
+bool BasicSolver<BoxSize>::nakedSingles(Grid& grid, UnitSet units) {
     bool changed = false;
-    for (int unit = 0; unit < Grid::GRID_SIZE; ++unit) {
-        changed |= findNakedPairsInRow(grid, unit);
-        changed |= findNakedPairsInColumn(grid, unit);
-        
-        int boxRow = (unit / Grid::SUBGRID_SIZE) * Grid::SUBGRID_SIZE;
-        int boxCol = (unit % Grid::SUBGRID_SIZE) * Grid::SUBGRID_SIZE;
-        changed |= findNakedPairsInBox(grid, boxRow, boxCol);
+    for (UnitSet rows = units & ROW_UNITS<Grid>; rows; rows &= rows - 1) {
+        for (const Index index : Grid::unitCells(Grid::lowestUnit(rows))) {
+            const Mask cand = grid.cellCandidates(index);
+            if (grid.cellValue(index) == Grid::EMPTY && Grid::countCandidates(cand) == 1) {
+                grid.set(index / Grid::GRID_SIZE, index % Grid::GRID_SIZE, Grid::lowestDigit(cand));
+                changed = true;
+            }
+        }
     }
     return changed;
 }
 
-bool Solver::findNakedPairsInRow(Grid& grid, int row) {
+// a digit seen in exactly one cell of a unit goes there
+template <int BoxSize>
+bool BasicSolver<BoxSize>::hiddenSingles(Grid& grid, UnitSet units) {
     bool changed = false;
-    std::vector<std::pair<int, std::set<int>>> candidatePairs; // <col, candidates>
+    for (; units; units &= units - 1) {
+        const auto& cells = Grid::unitCells(Grid::lowestUnit(units));
+        Mask once = 0;
+        Mask twice = 0;
+        for (const Index index : cells) {
+            const Mask cand = grid.cellCandidates(index);
+            twice |= once & cand;
+            once |= cand;
+        }
 
-    for (int col = 0; col < Grid::GRID_SIZE; ++col) {
-        const auto& candidates = grid.getCandidates(row, col);
-        if (candidates.size() == 2) {
-            candidatePairs.emplace_back(col, candidates);
+        for (Mask hidden = once & ~twice; hidden; hidden &= hidden - 1) {
+            const Mask bit = hidden & -hidden;
+            for (const Index index : cells) {
+                if (grid.cellValue(index) == Grid::EMPTY && (grid.cellCandidates(index) & bit)) {
+                    grid.set(index / Grid::GRID_SIZE, index % Grid::GRID_SIZE, Grid::lowestDigit(bit));
+                    changed = true;
+                    break;
+                }
+            }
         }
     }
+    return changed;
+}
 
-    for (size_t i = 0; i < candidatePairs.size(); ++i) {
-        for (size_t j = i + 1; j < candidatePairs.size(); ++j) {
-            if (candidatePairs[i].second == candidatePairs[j].second) {
-                const auto& pairValues = candidatePairs[i].second;
-                int col1 = candidatePairs[i].first;
-                int col2 = candidatePairs[j].first;
+template <int BoxSize>
+bool BasicSolver<BoxSize>::nakedPairs(Grid& grid, UnitSet units) {
+    bool changed = false;
+    for (; units; units &= units - 1) {
+        changed |= findNakedPairsInUnit(grid, Grid::lowestUnit(units));
+    }
+    return changed;
+}
 
-                for (int col = 0; col < Grid::GRID_SIZE; ++col) {
-                    if (col != col1 && col != col2) {
-                        for (int val : pairValues) {
-                            if (grid.getCandidates(row, col).count(val)) {
-                                grid.toggleCandidate(row, col, val);
-                                changed = true;
-                            }
-                        }
-                    }
+// two cells of a unit holding the same two candidates take those digits from the rest of the unit.
+// Pairs are read from the unit as it came in, so every removal stands on the grid the caller passed
+template <int BoxSize>
+bool BasicSolver<BoxSize>::findNakedPairsInUnit(Grid& grid, int unit) {
+    const auto& cells = Grid::unitCells(unit);
+    Mask cand[Grid::GRID_SIZE];
+    for (int i = 0; i < Grid::GRID_SIZE; ++i) {
+        cand[i] = grid.cellCandidates(cells[i]);
+    }
+    bool changed = false;
+    for (int i = 0; i < Grid::GRID_SIZE; ++i) {
+        const Mask pair = cand[i];
+        if (Grid::countCandidates(pair) != 2) {
+            continue;
+        }
+        for (int j = i + 1; j < Grid::GRID_SIZE; ++j) {
+            if (cand[j] != pair) {
+                continue;
+            }
+            for (int k = 0; k < Grid::GRID_SIZE; ++k) {
+                if (k != i && k != j) {
+                    changed |= removeCandidates(grid, cells[k], pair);
                 }
             }
+            break;
         }
     }
     return changed;
 }
 
-bool Solver::findNakedPairsInColumn(Grid& grid, int col) {
+// a digit confined to one row (column) inside a box is removed from that row (column) outside the box
+template <int BoxSize>
+bool BasicSolver<BoxSize>::pointingPairs(Grid& grid, UnitSet units) {
     bool changed = false;
-    std::vector<std::pair<int, std::set<int>>> candidatePairs; // <row, candidates>
+    for (UnitSet boxes = units >> (2 * Grid::GRID_SIZE); boxes; boxes &= boxes - 1) {
+        const int box = Grid::lowestUnit(boxes);
+        const int startRow = (box / Grid::SUBGRID_SIZE) * Grid::SUBGRID_SIZE;
+        const int startCol = (box % Grid::SUBGRID_SIZE) * Grid::SUBGRID_SIZE;
 
-    for (int row = 0; row < Grid::GRID_SIZE; ++row) {
-        const auto& candidates = grid.getCandidates(row, col);
-        if (candidates.size() == 2) {
-            candidatePairs.emplace_back(row, candidates);
+        Mask rowUnion[Grid::SUBGRID_SIZE] = {};
+        Mask colUnion[Grid::SUBGRID_SIZE] = {};
+        for (int r = 0; r < Grid::SUBGRID_SIZE; ++r) {
+            for (int c = 0; c < Grid::SUBGRID_SIZE; ++c) {
+                const Mask cand = grid.getCandidateMask(startRow + r, startCol + c);
+                rowUnion[r] |= cand;
+                colUnion[c] |= cand;
+            }
+        }
+
+        for (int i = 0; i < Grid::SUBGRID_SIZE; ++i) {
+            const Mask rowOnly = rowUnion[i] & ~unionOfOthers(rowUnion, i);
+            const Mask colOnly = colUnion[i] & ~unionOfOthers(colUnion, i);
+            for (int k = 0; k < Grid::GRID_SIZE; ++k) {
+                if (rowOnly && (k < startCol || k >= startCol + Grid::SUBGRID_SIZE)) {
+                    changed |= removeCandidates(grid, (startRow + i) * Grid::GRID_SIZE + k, rowOnly);
+                }
+                if (colOnly && (k < startRow || k >= startRow + Grid::SUBGRID_SIZE)) {
+                    changed |= removeCandidates(grid, k * Grid::GRID_SIZE + startCol + i, colOnly);
+                }
+            }
         }
     }
+    return changed;
+}
 
-    for (size_t i = 0; i < candidatePairs.size(); ++i) {
-        for (size_t j = i + 1; j < candidatePairs.size(); ++j) {
-            if (candidatePairs[i].second == candidatePairs[j].second) {
-                const auto& pairValues = candidatePairs[i].second;
-                int row1 = candidatePairs[i].first;
-                int row2 = candidatePairs[j].first;
+// a digit confined to one box inside a row (column) is removed from the rest of that box
+template <int BoxSize>
+bool BasicSolver<BoxSize>::boxLineReduction(Grid& grid, UnitSet units) {
+    bool changed = false;
+    for (int line = 0; line < Grid::GRID_SIZE; ++line) {
+        const bool rowDirty = (units >> line) & 1;
+        const bool colDirty = (units >> (Grid::GRID_SIZE + line)) & 1;
+        if (!rowDirty && !colDirty) {
+            continue;
+        }
+        Mask rowSegment[Grid::SUBGRID_SIZE] = {};
+        Mask colSegment[Grid::SUBGRID_SIZE] = {};
+        for (int k = 0; k < Grid::GRID_SIZE; ++k) {
+            if (rowDirty) {
+                rowSegment[k / Grid::SUBGRID_SIZE] |= grid.getCandidateMask(line, k);
+            }
+            if (colDirty) {
+                colSegment[k / Grid::SUBGRID_SIZE] |= grid.getCandidateMask(k, line);
+            }
+        }
 
-                for (int row = 0; row < Grid::GRID_SIZE; ++row) {
-                    if (row != row1 && row != row2) {
-                        for (int val : pairValues) {
-                            if (grid.getCandidates(row, col).count(val)) {
-                                grid.toggleCandidate(row, col, val);
-                                changed = true;
-                            }
-                        }
+        for (int i = 0; i < Grid::SUBGRID_SIZE; ++i) {
+            const Mask rowOnly = rowSegment[i] & ~unionOfOthers(rowSegment, i);
+            const Mask colOnly = colSegment[i] & ~unionOfOthers(colSegment, i);
+            const int lineStart = (line / Grid::SUBGRID_SIZE) * Grid::SUBGRID_SIZE; // first line of its band or stack
+            for (int r = 0; r < Grid::SUBGRID_SIZE; ++r) {
+                for (int c = 0; c < Grid::SUBGRID_SIZE; ++c) {
+                    // rowOnly: box (line's band, segment i), skipping `line` itself
+                    if (rowOnly && lineStart + r != line) {
+                        changed |= removeCandidates(grid, (lineStart + r) * Grid::GRID_SIZE + i * Grid::SUBGRID_SIZE + c, rowOnly);
+                    }
+                    // colOnly: box (segment i, line's stack), skipping `line` itself
+                    if (colOnly && lineStart + c != line) {
+                        changed |= removeCandidates(grid, (i * Grid::SUBGRID_SIZE + r) * Grid::GRID_SIZE + lineStart + c, colOnly);
                     }
                 }
             }
@@ -277,52 +779,107 @@ bool Solver::findNakedPairsInColumn(Grid& grid, int col) {
     return changed;
 }
 
-bool Solver::findNakedPairsInBox(Grid& grid, int startRow, int startCol) {
-    bool changed = false;
-    std::vector<std::pair<std::pair<int, int>, std::set<int>>> candidatePairs; // <(row,col), candidates>
-
-    for (int r = 0; r < Grid::SUBGRID_SIZE; ++r) {
-        for (int c = 0; c < Grid::SUBGRID_SIZE; ++c) {
-            int row = startRow + r;
-            int col = startCol + c;
-            const auto& candidates = grid.getCandidates(row, col);
-            
-            if (candidates.size() == 2) {
-                candidatePairs.emplace_back(std::make_pair(row, col), candidates);
-            }
+// a fish spans the whole board, any changed row or column is reason to look again
+template <int BoxSize>
+bool BasicSolver<BoxSize>::xWing(Grid& grid, UnitSet units) {
+    return (units & LINE_UNITS<Grid>) && findFish(grid, 2);
+}
+
+template <int BoxSize>
+bool BasicSolver<BoxSize>::swordfish(Grid& grid, UnitSet units) {
+    return (units & LINE_UNITS<Grid>) && findFish(grid, 3);
+}
+
+// `size` rows whose candidates for a digit cover only `size` columns own the digit in those columns,
+// so it is removed from the other rows there. Same with rows and columns swapped
+template <int BoxSize>
+bool BasicSolver<BoxSize>::findFish(Grid& grid, int size) {
+    // byRow[d][r] = columns of row r that still allow digit d + 1, byCol the transpose
+    Mask byRow[Grid::GRID_SIZE][Grid::GRID_SIZE] = {};
+    Mask byCol[Grid::GRID_SIZE][Grid::GRID_SIZE] = {};
+    for (int index = 0; index < Grid::CELL_COUNT; ++index) {
+        const int row = index / Grid::GRID_SIZE;
+        const int col = index % Grid::GRID_SIZE;
+        for (Mask cand = grid.cellCandidates(index); cand; cand &= cand - 1) {
+            const int digit = Grid::lowestDigit(cand) - 1;
+            byRow[digit][row] |= static_cast<Mask>(Mask(1) << col);
+            byCol[digit][col] |= static_cast<Mask>(Mask(1) << row);
         }
     }
 
-    for (size_t i = 0; i < candidatePairs.size(); ++i) {
-        for (size_t j = i + 1; j < candidatePairs.size(); ++j) {
-            if (candidatePairs[i].second == candidatePairs[j].second) {
-                const auto& pairValues = candidatePairs[i].second;
-                auto [row1, col1] = candidatePairs[i].first;
-                auto [row2, col2] = candidatePairs[j].first;
+    // masks go stale as candidates are removed, but only by keeping extra positions,
+    // which can hide a fish and never invent one
+    bool changed = false;
+    for (int digit = 1; digit <= Grid::GRID_SIZE; ++digit) {
+        const Mask bit = Grid::digitMask(digit);
+
+        for (int transposed = 0; transposed < 2; ++transposed) {
+            const Mask* lines = transposed ? byCol[digit - 1] : byRow[digit - 1];
 
-                for (int r = 0; r < Grid::SUBGRID_SIZE; ++r) {
-                    for (int c = 0; c < Grid::SUBGRID_SIZE; ++c) {
-                        int row = startRow + r;
-                        int col = startCol + c;
-                        
-                        if ((row == row1 && col == col1) || (row == row2 && col == col2)) {
+            int bases[Grid::GRID_SIZE];
+            int baseCount = 0;
+            for (int line = 0; line < Grid::GRID_SIZE; ++line) {
+                const int count = Grid::countCandidates(lines[line]);
+                if (count >= 2 && count <= size) {
+                    bases[baseCount++] = line;
+                }
+            }
+
+            // walk every `size`-subset of the base lines, at most C(GRID_SIZE, 3) of them
+            int pick[3] = {};
+            for (int i = 0; i < size; ++i) {
+                pick[i] = i;
+            }
+            while (baseCount >= size) {
+                Mask cover = 0;
+                Mask baseLines = 0;
+                for (int i = 0; i < size; ++i) {
+                    cover |= lines[bases[pick[i]]];
+                    baseLines |= static_cast<Mask>(Mask(1) << bases[pick[i]]);
+                }
+
+                if (Grid::countCandidates(cover) == size) {
+                    for (int line = 0; line < Grid::GRID_SIZE; ++line) {
+                        if ((baseLines >> line) & 1) {
                             continue;
                         }
-
-                        for (int val : pairValues) {
-                            if (grid.getCandidates(row, col).count(val)) {
-                                grid.toggleCandidate(row, col, val);
-                                changed = true;
-                            }
+                        for (Mask rest = lines[line] & cover; rest; rest &= rest - 1) {
+                            const int other = Grid::lowestDigit(rest) - 1;
+                            const int index = transposed ? other * Grid::GRID_SIZE + line : line * Grid::GRID_SIZE + other;
+                            changed |= removeCandidates(grid, index, bit);
                         }
                     }
                 }
+
+                int i = size - 1;
+                while (i >= 0 && pick[i] == baseCount - size + i) {
+                    --i;
+                }
+                if (i < 0) {
+                    break;
+                }
+                ++pick[i];
+                for (int j = i + 1; j < size; ++j) {
+                    pick[j] = pick[j - 1] + 1;
+                }
             }
         }
     }
     return changed;
 }
 
-bool Solver::canPlace(const Grid& grid, int row, int col, int num) {
-    return grid.getCandidates(row, col).count(num) > 0;
-}
\ No newline at end of file
+template <int BoxSize>
+bool BasicSolver<BoxSize>::removeCandidates(Grid& grid, int index, Mask mask) {
+    const int row = index / Grid::GRID_SIZE;
+    const int col = index % Grid::GRID_SIZE;
+    const Mask cand = grid.getCandidateMask(row, col);
+    if ((cand & mask) == 0) {
+        return false;
+    }
+    grid.setCandidateMask(row, col, cand & ~mask);
+    return true;
+}
+
+template class BasicSolver<3>;
+template class BasicSolver<4>;
+template class BasicSolver<5>;
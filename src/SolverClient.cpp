@@ -0,0 +1,344 @@
+#include "SolverClient.hpp"
+#include "BatchIO.hpp"
+#include "Grid.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Protocol = SolverProtocol;
+
+    constexpr std::size_t OUTPUT_FLUSH_BYTES = 1 << 20;
+
+    // a request in input order. Lines that do not parse are never sent
+    struct Pending {
+        const char* line;
+        std::size_t length;
+        bool sent;
+        std::uint32_t id;
+    };
+
+    struct InFlight {
+        bool done = false;
+        Protocol::Status status = Protocol::Status::Ok;
+        std::string payload;
+        Clock::time_point sent;
+    };
+
+    void appendDigits(const std::string& cells, std::string& output) {
+        for (char value : cells) {
+            output.push_back(static_cast<char>('0' + value));
+        }
+    }
+
+    // keeps options.window requests in flight. feed sends the next request (or records an
+    // invalid line) and returns false at the end, emit formats a finished one in input order
+    template <typename Feed, typename Emit>
+    SolverClient::RunSummary pipeline(const std::string& socketPath, int outputFd, const SolverClient::RunOptions& options, Feed feed, Emit emit) {
+        const Clock::time_point start = Clock::now();
+        SolverClient client(socketPath);
+        std::size_t window = 1;
+        while (window < options.window) {
+            window *= 2;
+        }
+        std::vector<InFlight> inFlight(window);
+        std::deque<Pending> pending;
+        std::size_t outstanding = 0;   // sent and not written out, each holds its slot in inFlight
+        bool fed = false;
+        std::string output;
+        SolverClient::RunSummary summary;
+        SolverClient::Reply reply;
+
+        for (;;) {
+            while (!fed && outstanding < window) {
+                if (!feed(client, pending)) {
+                    fed = true;
+                    break;
+                }
+                if (pending.back().sent) {
+                    InFlight& slot = inFlight[pending.back().id % window];
+                    slot.done = false;
+                    slot.sent = Clock::now();
+                    ++outstanding;
+                }
+            }
+
+            while (!pending.empty()) {
+                const Pending& front = pending.front();
+                if (!front.sent) {
+                    ++summary.invalid;
+                    emit(front, nullptr, output);
+                }
+                else if (inFlight[front.id % window].done) {
+                    const InFlight& slot = inFlight[front.id % window];
+                    summary.badRequests += slot.status == Protocol::Status::BadRequest;
+                    summary.failed += slot.status == Protocol::Status::Failed;
+                    emit(front, &slot, output);
+                    --outstanding;
+                }
+                else {
+                    break;
+                }
+                ++summary.requests;
+                pending.pop_front();
+            }
+            if (output.size() >= OUTPUT_FLUSH_BYTES || (fed && pending.empty())) {
+                BatchIO::writeAll(outputFd, output.data(), output.size(), "SolverClient");
+                output.clear();
+            }
+            if (pending.empty()) {
+                if (fed) {
+                    break;
+                }
+                continue;
+            }
+
+            // the oldest request is still out
+            client.receive(reply);
+            InFlight& slot = inFlight[reply.id % window];
+            slot.done = true;
+            slot.status = reply.status;
+            slot.payload.swap(reply.payload);
+            summary.latency.record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - slot.sent).count()));
+        }
+        summary.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return summary;
+    }
+}
+
+SolverClient::SolverClient(const std::string& socketPath) : fd(-1), nextId(0), inboxStart(0) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("SolverClient::SolverClient - Bad socket path " + socketPath);
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        const int error = errno;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        throw std::runtime_error("SolverClient::SolverClient - Cannot connect to " + socketPath + ": " + std::strerror(error));
+    }
+}
+
+SolverClient::~SolverClient() {
+    ::close(fd);
+}
+
+std::uint32_t SolverClient::send(Protocol::Type type, int option, const void* payload, std::size_t length) {
+    if (length > Protocol::MAX_REQUEST_PAYLOAD) {
+        throw std::invalid_argument("SolverClient::send - Payload too long");
+    }
+    Protocol::Header header = {};
+    header.length = static_cast<std::uint32_t>(length);
+    header.id = nextId++;
+    header.type = type;
+    header.option = static_cast<std::uint8_t>(option);
+    std::uint8_t bytes[Protocol::HEADER_BYTES];
+    Protocol::writeHeader(header, bytes);
+    outbox.append(reinterpret_cast<const char*>(bytes), Protocol::HEADER_BYTES);
+    outbox.append(static_cast<const char*>(payload), length);
+    if (outbox.size() >= 64 << 10) {
+        flush();
+    }
+    return header.id;
+}
+
+void SolverClient::flush() {
+    BatchIO::writeAll(fd, outbox.data(), outbox.size(), "SolverClient", MSG_NOSIGNAL);
+    outbox.clear();
+}
+
+void SolverClient::receive(Reply& reply) {
+    flush();
+    for (;;) {
+        const std::size_t available = inbox.size() - inboxStart;
+        if (available >= Protocol::HEADER_BYTES) {
+            const Protocol::Header header = Protocol::readHeader(reinterpret_cast<const std::uint8_t*>(inbox.data()) + inboxStart);
+            if (header.length > Protocol::MAX_REPLY_PAYLOAD) {
+                throw std::runtime_error("SolverClient::receive - Reply too long, not a solver daemon?");
+            }
+            if (available >= Protocol::HEADER_BYTES + header.length) {
+                reply.id = header.id;
+                reply.type = header.type;
+                reply.status = header.status;
+                reply.payload.assign(inbox, inboxStart + Protocol::HEADER_BYTES, header.length);
+                inboxStart += Protocol::HEADER_BYTES + header.length;
+                return;
+            }
+        }
+
+        inbox.erase(0, inboxStart);
+        inboxStart = 0;
+        const std::size_t used = inbox.size();
+        inbox.resize(used + (64 << 10));
+        const ssize_t got = ::read(fd, &inbox[used], inbox.size() - used);
+        inbox.resize(used + static_cast<std::size_t>(std::max<ssize_t>(got, 0)));
+        if (got == 0) {
+            throw std::runtime_error("SolverClient::receive - Daemon closed the connection");
+        }
+        if (got < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("SolverClient::receive - Read failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+bool SolverClient::solve(std::uint8_t* cells, Solver::Strategy strategy) {
+    const Reply& answer = call(Protocol::Type::Solve, static_cast<int>(strategy), cells, Grid::CELL_COUNT);
+    if (answer.status != Protocol::Status::Ok) {
+        return false;
+    }
+    std::memcpy(cells, answer.payload.data(), Grid::CELL_COUNT);
+    return true;
+}
+
+Protocol::Status SolverClient::unique(const std::uint8_t* cells) {
+    return call(Protocol::Type::Unique, 0, cells, Grid::CELL_COUNT).status;
+}
+
+void SolverClient::generate(GeneratorDifficulty difficulty, std::uint8_t* cells) {
+    const Reply& answer = call(Protocol::Type::Generate, static_cast<int>(difficulty), nullptr, 0);
+    std::memcpy(cells, answer.payload.data(), Grid::CELL_COUNT);
+}
+
+void SolverClient::generate(GeneratorDifficulty difficulty, std::uint64_t seed, std::uint8_t* cells) {
+    const Reply& answer = call(Protocol::Type::Generate, static_cast<int>(difficulty), &seed, sizeof(seed));
+    std::memcpy(cells, answer.payload.data(), Grid::CELL_COUNT);
+}
+
+int SolverClient::rate(const std::uint8_t* cells) {
+    return static_cast<std::uint8_t>(call(Protocol::Type::Rate, 0, cells, Grid::CELL_COUNT).payload[0]);
+}
+
+std::string SolverClient::stats() {
+    return call(Protocol::Type::Stats, 0, nullptr, 0).payload;
+}
+
+// the expected payload size is only missing after a bad request or a failure, and both throw
+const SolverClient::Reply& SolverClient::call(Protocol::Type type, int option, const void* payload, std::size_t length) {
+    const std::uint32_t id = send(type, option, payload, length);
+    receive(reply);
+    if (reply.id != id) {
+        throw std::logic_error("SolverClient::call - Reply to another request, pipelined requests still in flight");
+    }
+    if (reply.status == Protocol::Status::BadRequest) {
+        throw std::invalid_argument(std::string("SolverClient::call - Daemon rejected the ") + Protocol::typeName(type) + " request");
+    }
+    if (reply.status == Protocol::Status::Failed) {
+        throw std::runtime_error(std::string("SolverClient::call - Daemon failed the ") + Protocol::typeName(type) + " request");
+    }
+    return reply;
+}
+
+SolverClient::RunSummary SolverClient::runFile(const std::string& socketPath, const std::string& inputPath, int outputFd, const RunOptions& options) {
+    if (options.type == Protocol::Type::Generate || options.type == Protocol::Type::Stats) {
+        throw std::invalid_argument("SolverClient::runFile - Puzzle files take solve, unique or rate requests");
+    }
+    const MappedFile input(inputPath);
+    const char* next = input.data();
+    const char* const end = input.data() + input.size();
+    const int option = options.type == Protocol::Type::Solve ? static_cast<int>(options.strategy) : 0;
+
+    auto feed = [&](SolverClient& client, std::deque<Pending>& pending) {
+        std::uint8_t cells[Grid::CELL_COUNT];
+        std::string_view line;
+        if (!BatchIO::nextLine(next, end, line)) {
+            return false;
+        }
+        if (Grid::parseCells(line, cells)) {
+            pending.push_back({line.data(), line.size(), true, client.send(options.type, option, cells, Grid::CELL_COUNT)});
+        }
+        else {
+            pending.push_back({line.data(), line.size(), false, 0});
+        }
+        return true;
+    };
+
+    auto emit = [&](const Pending& request, const InFlight* result, std::string& output) {
+        output.append(request.line, request.length);
+        if (!result) {
+            output.append(" invalid");
+        }
+        else if (result->status == Protocol::Status::BadRequest) {
+            output.append(" bad-request");
+        }
+        else if (result->status == Protocol::Status::Failed) {
+            output.append(" failed");
+        }
+        else if (options.type == Protocol::Type::Solve) {
+            if (result->status == Protocol::Status::Ok) {
+                output.resize(output.size() - request.length);
+                appendDigits(result->payload, output);
+            }
+            else {
+                output.append(" unsolved");
+            }
+        }
+        else if (options.type == Protocol::Type::Unique) {
+            output.append(result->status == Protocol::Status::Ok ? " unique"
+                        : result->status == Protocol::Status::NotUnique ? " not-unique" : " no-solution");
+        }
+        else {
+            output.append(" ").append(std::to_string(static_cast<std::uint8_t>(result->payload[0])));
+        }
+        output.push_back('\n');
+    };
+
+    return pipeline(socketPath, outputFd, options, feed, emit);
+}
+
+SolverClient::RunSummary SolverClient::runGenerate(const std::string& socketPath, std::size_t count, int outputFd, const RunOptions& options) {
+    std::size_t generated = 0;
+    const int option = static_cast<int>(options.difficulty);
+
+    auto feed = [&](SolverClient& client, std::deque<Pending>& pending) {
+        if (generated == count) {
+            return false;
+        }
+        const std::uint64_t seed = options.seed + generated;
+        const std::uint32_t id = options.seeded ? client.send(Protocol::Type::Generate, option, &seed, sizeof(seed))
+                                                : client.send(Protocol::Type::Generate, option, nullptr, 0);
+        pending.push_back({nullptr, 0, true, id});
+        ++generated;
+        return true;
+    };
+
+    auto emit = [&](const Pending&, const InFlight* result, std::string& output) {
+        if (result->status == Protocol::Status::Ok) {
+            appendDigits(result->payload, output);
+        }
+        else {
+            output.append("failed");
+        }
+        output.push_back('\n');
+    };
+
+    return pipeline(socketPath, outputFd, options, feed, emit);
+}
+
+void SolverClient::printSummary(const RunSummary& summary, std::ostream& out) {
+    const double rate = summary.seconds > 0 ? summary.requests / summary.seconds : 0.0;
+    out << std::fixed << std::setprecision(2)
+        << "requests:   " << summary.requests << " (" << summary.invalid << " invalid, "
+        << summary.badRequests << " rejected, " << summary.failed << " failed)\n"
+        << "wall time:  " << summary.seconds << " s\n"
+        << "throughput: " << rate << " requests/s\n"
+        << "latency:    p50 " << summary.latency.percentile(0.50) / 1000.0 << " us, p99 "
+        << summary.latency.percentile(0.99) / 1000.0 << " us, max "
+        << summary.latency.max() / 1000.0 << " us\n";
+}
@@ -0,0 +1,482 @@
+#include "SolverDaemon.hpp"
+#include "Generator.hpp"
+#include "Grid.hpp"
+#include "PuzzleDatabase.hpp"
+#include "Solver.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Protocol = SolverProtocol;
+
+    constexpr std::size_t READ_BYTES = 64 << 10;     // per connection and round
+
+    void setNonBlocking(int fd) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    bool validCells(const std::uint8_t* cells) {
+        return std::all_of(cells, cells + Grid::CELL_COUNT, [](std::uint8_t value) { return value <= Grid::GRID_SIZE; });
+    }
+
+    bool validDifficulty(int value) {
+        return value == static_cast<int>(GeneratorDifficulty::EASY) || value == static_cast<int>(GeneratorDifficulty::MEDIUM)
+            || value == static_cast<int>(GeneratorDifficulty::HARD) || value == static_cast<int>(GeneratorDifficulty::EXPERT);
+    }
+}
+
+struct SolverDaemon::Request {
+    std::uint64_t connection;
+    Protocol::Header header;
+    std::uint8_t payload[Protocol::MAX_REQUEST_PAYLOAD];
+    Clock::time_point received;
+};
+
+struct SolverDaemon::Reply {
+    std::uint64_t connection;
+    Protocol::Header header;
+    std::uint8_t payload[Grid::CELL_COUNT];
+};
+
+struct SolverDaemon::Connection {
+    std::uint64_t id;
+    int fd;
+    std::string inbox;
+    std::size_t inboxStart = 0;      // bytes before it are parsed
+    std::string outbox;
+    std::size_t outboxStart = 0;     // bytes before it are written
+    std::size_t inFlight = 0;        // requests handed to the pool
+    bool peerClosed = false;
+    bool throttled = false;
+
+    std::size_t unsent() const { return outbox.size() - outboxStart; }
+};
+
+SolverDaemon::SolverDaemon(const Options& options)
+    : options(options), listenFd(-1), wakeFds{-1, -1}, stopping(false), queued(0), nextConnection(0), pool(options.threads) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.empty() || options.socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("SolverDaemon::SolverDaemon - Socket path must be 1 to " +
+                                 std::to_string(sizeof(address.sun_path) - 1) + " characters");
+    }
+    std::memcpy(address.sun_path, options.socketPath.c_str(), options.socketPath.size());
+
+    if (::pipe(wakeFds) != 0) {
+        throw std::runtime_error(std::string("SolverDaemon::SolverDaemon - Cannot create wake pipe: ") + std::strerror(errno));
+    }
+    setNonBlocking(wakeFds[0]);
+    setNonBlocking(wakeFds[1]);
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(options.socketPath.c_str());
+    if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd, SOMAXCONN) != 0) {
+        const int error = errno;
+        if (listenFd >= 0) {
+            ::close(listenFd);
+        }
+        ::close(wakeFds[0]);
+        ::close(wakeFds[1]);
+        throw std::runtime_error("SolverDaemon::SolverDaemon - Cannot listen on " + options.socketPath + ": " + std::strerror(error));
+    }
+    setNonBlocking(listenFd);
+}
+
+SolverDaemon::~SolverDaemon() {
+    pool.waitIdle();
+    for (auto& entry : connections) {
+        ::close(entry.second->fd);
+    }
+    ::close(listenFd);
+    ::unlink(options.socketPath.c_str());
+    ::close(wakeFds[0]);
+    ::close(wakeFds[1]);
+}
+
+void SolverDaemon::run() {
+    std::vector<pollfd> fds;
+    std::vector<std::uint64_t> polled;          // connection of fds[i + 2]
+    std::vector<Request> requests;
+    bool paused = false;
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        const bool full = queued.load(std::memory_order_relaxed) >= options.maxQueued;
+        if (full && !paused) {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            ++totals.pauses;
+        }
+        paused = full;
+
+        fds.clear();
+        polled.clear();
+        fds.push_back({wakeFds[0], POLLIN, 0});
+        fds.push_back({listenFd, static_cast<short>(connections.size() < options.maxConnections ? POLLIN : 0), 0});
+        std::uint64_t throttles = 0;
+        for (const auto& entry : connections) {
+            Connection& connection = *entry.second;
+            const bool throttled = connection.unsent() >= options.maxUnsentBytes;
+            throttles += throttled && !connection.throttled;
+            connection.throttled = throttled;
+            short events = 0;
+            if (!paused && !throttled && !connection.peerClosed) {
+                events |= POLLIN;
+            }
+            if (connection.outboxStart < connection.outbox.size()) {
+                events |= POLLOUT;
+            }
+            // a hung up peer would keep poll returning at once, skip it until there is output
+            fds.push_back({events == 0 && connection.peerClosed ? -1 : connection.fd, events, 0});
+            polled.push_back(entry.first);
+        }
+        if (throttles) {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            totals.throttles += throttles;
+        }
+
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("SolverDaemon::run - poll failed: ") + std::strerror(errno));
+        }
+        if (fds[0].revents & POLLIN) {
+            char drain[256];
+            while (::read(wakeFds[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+        if (stopping.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        deliverCompleted();
+        if (fds[1].revents & POLLIN) {
+            acceptConnections();
+        }
+
+        // every connection gets a look: replies may have arrived for it, and requests left
+        // unparsed at the queue limit can go now that replies have freed room
+        for (std::size_t i = 0; i < polled.size(); ++i) {
+            const auto found = connections.find(polled[i]);
+            Connection& connection = *found->second;
+            const short revents = fds[i + 2].revents;
+            bool alive = true;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                alive = readFrom(connection);
+            }
+            alive = alive && parseRequests(connection, requests);
+            if (alive && connection.outboxStart < connection.outbox.size()) {
+                alive = writeTo(connection);
+            }
+            const bool finished = connection.peerClosed && connection.inFlight == 0 && connection.outboxStart == connection.outbox.size();
+            if (!alive || finished) {
+                ::close(connection.fd);
+                connections.erase(found);
+            }
+        }
+        submitBatches(requests);
+    }
+
+    for (auto& entry : connections) {
+        ::close(entry.second->fd);
+    }
+    connections.clear();
+}
+
+void SolverDaemon::stop() {
+    stopping.store(true, std::memory_order_release);
+    const char wake = 1;
+    const ssize_t ignored = ::write(wakeFds[1], &wake, 1);
+    (void)ignored;
+}
+
+SolverDaemon::Counters SolverDaemon::counters() const {
+    std::lock_guard<std::mutex> lock(completedMutex);
+    return totals;
+}
+
+LatencyHistogram SolverDaemon::latency(Protocol::Type type) const {
+    std::lock_guard<std::mutex> lock(completedMutex);
+    return latencies[static_cast<int>(type) - 1];
+}
+
+std::string SolverDaemon::statsJson() const {
+    std::lock_guard<std::mutex> lock(completedMutex);
+    std::ostringstream out;
+    out << "{\"connections\": " << totals.connections << ", \"requests\": " << totals.requests
+        << ", \"batches\": " << totals.batches << ", \"bad_requests\": " << totals.badRequests
+        << ", \"failed\": " << totals.failed << ", \"pauses\": " << totals.pauses
+        << ", \"throttles\": " << totals.throttles << ", \"queued\": " << queued.load() << ", \"latency\": {";
+    for (int type = 1; type < static_cast<int>(Protocol::Type::Stats); ++type) {
+        const LatencyHistogram& histogram = latencies[type - 1];
+        out << (type > 1 ? ", " : "") << '"' << Protocol::typeName(static_cast<Protocol::Type>(type)) << "\": {"
+            << "\"count\": " << histogram.count()
+            << ", \"mean_us\": " << histogram.mean() / 1000.0
+            << ", \"p50_us\": " << histogram.percentile(0.50) / 1000.0
+            << ", \"p99_us\": " << histogram.percentile(0.99) / 1000.0
+            << ", \"max_us\": " << histogram.max() / 1000.0 << "}";
+    }
+    out << "}}";
+    return out.str();
+}
+
+void SolverDaemon::acceptConnections() {
+    while (connections.size() < options.maxConnections) {
+        const int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        setNonBlocking(fd);
+        auto connection = std::make_unique<Connection>();
+        connection->id = nextConnection++;
+        connection->fd = fd;
+        connections.emplace(connection->id, std::move(connection));
+        std::lock_guard<std::mutex> lock(completedMutex);
+        ++totals.connections;
+    }
+}
+
+// false when the connection is broken
+bool SolverDaemon::readFrom(Connection& connection) {
+    const std::size_t used = connection.inbox.size();
+    connection.inbox.resize(used + READ_BYTES);
+    const ssize_t got = ::read(connection.fd, &connection.inbox[used], READ_BYTES);
+    connection.inbox.resize(used + static_cast<std::size_t>(std::max<ssize_t>(got, 0)));
+    if (got == 0) {
+        connection.peerClosed = true;
+    }
+    return got >= 0 || errno == EAGAIN || errno == EINTR;
+}
+
+// complete requests into `requests` until the queue is full or the connection has maxUnsentBytes
+// of replies waiting. Stats and malformed requests are answered here. false when the stream is
+// not SolverProtocol
+bool SolverDaemon::parseRequests(Connection& connection, std::vector<Request>& requests) {
+    std::size_t accepted = 0;
+    std::size_t rejected = 0;
+    while (queued.load(std::memory_order_relaxed) < options.maxQueued && connection.unsent() < options.maxUnsentBytes) {
+        const std::size_t available = connection.inbox.size() - connection.inboxStart;
+        if (available < Protocol::HEADER_BYTES) {
+            break;
+        }
+        const std::uint8_t* frame = reinterpret_cast<const std::uint8_t*>(connection.inbox.data()) + connection.inboxStart;
+        const Protocol::Header header = Protocol::readHeader(frame);
+        if (header.length > Protocol::MAX_REQUEST_PAYLOAD) {
+            return false;
+        }
+        if (available < Protocol::HEADER_BYTES + header.length) {
+            break;
+        }
+        connection.inboxStart += Protocol::HEADER_BYTES + header.length;
+
+        if (header.type == Protocol::Type::Stats) {
+            const std::string stats = statsJson();
+            replyNow(connection, header, Protocol::Status::Ok, stats.data(), stats.size());
+            continue;
+        }
+        if (header.type < Protocol::Type::Solve || header.type > Protocol::Type::Stats) {
+            replyNow(connection, header, Protocol::Status::BadRequest, nullptr, 0);
+            ++rejected;
+            continue;
+        }
+
+        requests.emplace_back();
+        Request& request = requests.back();
+        request.connection = connection.id;
+        request.header = header;
+        std::memcpy(request.payload, frame + Protocol::HEADER_BYTES, header.length);
+        request.received = Clock::now();
+        ++connection.inFlight;
+        queued.fetch_add(1, std::memory_order_relaxed);
+        ++accepted;
+    }
+
+    if (connection.inboxStart == connection.inbox.size()) {
+        connection.inbox.clear();
+        connection.inboxStart = 0;
+    }
+    else if (connection.inboxStart >= READ_BYTES) {
+        connection.inbox.erase(0, connection.inboxStart);
+        connection.inboxStart = 0;
+    }
+    if (accepted || rejected) {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        totals.requests += accepted + rejected;
+        totals.badRequests += rejected;
+    }
+    return true;
+}
+
+void SolverDaemon::replyNow(Connection& connection, const Protocol::Header& request, Protocol::Status status,
+                            const void* payload, std::size_t length) {
+    Protocol::Header header = request;
+    header.length = static_cast<std::uint32_t>(length);
+    header.status = status;
+    std::uint8_t bytes[Protocol::HEADER_BYTES];
+    Protocol::writeHeader(header, bytes);
+    connection.outbox.append(reinterpret_cast<const char*>(bytes), Protocol::HEADER_BYTES);
+    connection.outbox.append(static_cast<const char*>(payload), length);
+}
+
+// false when the connection is broken
+bool SolverDaemon::writeTo(Connection& connection) {
+    while (connection.outboxStart < connection.outbox.size()) {
+        const ssize_t sent = ::send(connection.fd, connection.outbox.data() + connection.outboxStart,
+                                    connection.outbox.size() - connection.outboxStart, MSG_NOSIGNAL);
+        if (sent < 0) {
+            // a client that keeps up only partly must not let the written bytes pile up
+            if (connection.outboxStart >= READ_BYTES) {
+                connection.outbox.erase(0, connection.outboxStart);
+                connection.outboxStart = 0;
+            }
+            return errno == EAGAIN || errno == EINTR;
+        }
+        connection.outboxStart += static_cast<std::size_t>(sent);
+    }
+    connection.outbox.clear();
+    connection.outboxStart = 0;
+    return true;
+}
+
+// replies of connections closed in the meantime are dropped
+void SolverDaemon::deliverCompleted() {
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        delivering.swap(completed);
+    }
+    for (const Reply& reply : delivering) {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        const auto found = connections.find(reply.connection);
+        if (found == connections.end()) {
+            continue;
+        }
+        Connection& connection = *found->second;
+        --connection.inFlight;
+        replyNow(connection, reply.header, reply.header.status, reply.payload, reply.header.length);
+    }
+    delivering.clear();
+}
+
+void SolverDaemon::submitBatches(std::vector<Request>& requests) {
+    const std::size_t batchSize = std::max<std::size_t>(options.maxBatch, 1);
+    for (std::size_t first = 0; first < requests.size(); first += batchSize) {
+        const std::size_t last = std::min(requests.size(), first + batchSize);
+        pool.submit([this, batch = std::vector<Request>(requests.begin() + first, requests.begin() + last)]() mutable {
+            runBatch(batch);
+        });
+    }
+    requests.clear();
+}
+
+void SolverDaemon::runBatch(std::vector<Request>& batch) {
+    // every request gets a reply, or its client would wait for it forever
+    std::vector<Reply> replies(batch.size());
+    std::uint64_t failed = 0;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        try {
+            execute(batch[i], replies[i]);
+        }
+        catch (const std::exception&) {
+            replies[i].connection = batch[i].connection;
+            replies[i].header = batch[i].header;
+            replies[i].header.length = 0;
+            replies[i].header.status = Protocol::Status::Failed;
+            ++failed;
+        }
+    }
+    const Clock::time_point now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - batch[i].received);
+            latencies[static_cast<int>(batch[i].header.type) - 1].record(static_cast<std::uint64_t>(elapsed.count()));
+        }
+        for (const Reply& reply : replies) {
+            totals.badRequests += reply.header.status == Protocol::Status::BadRequest;
+        }
+        completed.insert(completed.end(), replies.begin(), replies.end());
+        totals.failed += failed;
+        ++totals.batches;
+    }
+    const char wake = 1;
+    const ssize_t ignored = ::write(wakeFds[1], &wake, 1); // a full pipe wakes the loop just the same
+    (void)ignored;
+}
+
+void SolverDaemon::execute(const Request& request, Reply& reply) {
+    const Protocol::Header& header = request.header;
+    reply.connection = request.connection;
+    reply.header = header;
+    reply.header.length = 0;
+    reply.header.status = Protocol::Status::BadRequest;
+
+    const bool withCells = header.length == Grid::CELL_COUNT && validCells(request.payload);
+    switch (header.type) {
+        case Protocol::Type::Solve: {
+            if (!withCells || header.option > static_cast<int>(Solver::Strategy::BITBOARD)) {
+                return;
+            }
+            Grid grid;
+            grid.loadFromCells(request.payload);
+            if (!Solver::solve(grid, static_cast<Solver::Strategy>(header.option)) || !grid.isComplete()) {
+                reply.header.status = Protocol::Status::NoSolution;
+                return;
+            }
+            std::memcpy(reply.payload, grid.getCells().data(), Grid::CELL_COUNT);
+            reply.header.length = Grid::CELL_COUNT;
+            break;
+        }
+        case Protocol::Type::Unique: {
+            if (!withCells) {
+                return;
+            }
+            Grid grid;
+            grid.loadFromCells(request.payload);
+            const int solutions = Solver::countSolutions(grid, 2);
+            reply.header.status = solutions == 1 ? Protocol::Status::Ok
+                                : solutions == 0 ? Protocol::Status::NoSolution : Protocol::Status::NotUnique;
+            return;
+        }
+        case Protocol::Type::Generate: {
+            if ((header.length != 0 && header.length != sizeof(std::uint64_t)) || !validDifficulty(header.option)) {
+                return;
+            }
+            const GeneratorDifficulty difficulty = static_cast<GeneratorDifficulty>(header.option);
+            Grid puzzle;
+            if (header.length == 0) {
+                thread_local Generator generator;
+                puzzle = generator.generate(difficulty);
+            }
+            else {
+                std::uint64_t seed;
+                std::memcpy(&seed, request.payload, sizeof(seed));
+                Generator generator{seed};  // braces: a narrower seed parameter would not compile
+                puzzle = generator.generate(difficulty);
+            }
+            std::memcpy(reply.payload, puzzle.getCells().data(), Grid::CELL_COUNT);
+            reply.header.length = Grid::CELL_COUNT;
+            break;
+        }
+        case Protocol::Type::Rate: {
+            if (!withCells) {
+                return;
+            }
+            reply.payload[0] = static_cast<std::uint8_t>(PuzzleDatabase::rate(request.payload));
+            reply.header.length = 1;
+            break;
+        }
+        case Protocol::Type::Stats:
+            return;
+    }
+    reply.header.status = Protocol::Status::Ok;
+}
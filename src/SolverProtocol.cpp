@@ -0,0 +1,23 @@
+#include "SolverProtocol.hpp"
+
+const char* SolverProtocol::typeName(Type type) {
+    switch (type) {
+        case Type::Solve:    return "solve";
+        case Type::Unique:   return "unique";
+        case Type::Generate: return "generate";
+        case Type::Rate:     return "rate";
+        case Type::Stats:    return "stats";
+    }
+    return "unknown";
+}
+
+const char* SolverProtocol::statusName(Status status) {
+    switch (status) {
+        case Status::Ok:         return "ok";
+        case Status::NoSolution: return "no-solution";
+        case Status::NotUnique:  return "not-unique";
+        case Status::BadRequest: return "bad-request";
+        case Status::Failed:     return "failed";
+    }
+    return "unknown";
+}
@@ -0,0 +1,31 @@
+#include "SolverStats.hpp"
+#include <ostream>
+
+const char* const SolverStats::TECHNIQUE_NAMES[TECHNIQUE_COUNT] = {
+    "nakedSingles",
+    "hiddenSingles",
+    "nakedPairs",
+    "pointingPairs",
+    "boxLineReduction",
+    "xWing",
+    "swordfish"
+};
+
+void SolverStats::writeJson(std::ostream& out) const {
+    out << "{\n"
+        << "  \"solveCalls\": " << solveCalls << ",\n"
+        << "  \"countSolutionsCalls\": " << countSolutionsCalls << ",\n"
+        << "  \"nanos\": " << nanos << ",\n"
+        << "  \"search\": {\"nodes\": " << nodes << ", \"backtracks\": " << backtracks
+        << ", \"propagations\": " << propagations << ", \"maxDepth\": " << maxDepth << "},\n"
+        << "  \"techniques\": {\n";
+    for (int i = 0; i < TECHNIQUE_COUNT; ++i) {
+        const Technique& technique = techniques[i];
+        out << "    \"" << TECHNIQUE_NAMES[i] << "\": {\"runs\": " << technique.runs
+            << ", \"placements\": " << technique.placements
+            << ", \"eliminations\": " << technique.eliminations
+            << ", \"nanos\": " << technique.nanos << "}"
+            << (i + 1 < TECHNIQUE_COUNT ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+}
@@ -0,0 +1,124 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace {
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local unsigned currentWorker = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threads)
+    : queued(0), pending(0), idle(0), nextQueue(0), stopping(false) {
+    const unsigned count = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    workers.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    const unsigned index = (currentPool == this)
+        ? currentWorker
+        : nextQueue.fetch_add(1, std::memory_order_relaxed) % size();
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+    {
+        // a worker checks `queued` under this lock, so taking it here rules out a lost wakeup
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::waitIdle() {
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    finished.wait(lock, [&] { return pending.load() == 0; });
+    if (firstError) {
+        std::exception_ptr error = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    currentPool = this;
+    currentWorker = index;
+
+    std::function<void()> task;
+    for (;;) {
+        if (popOwn(index, task) || steal(index, task)) {
+            queued.fetch_sub(1);
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping) {
+            return;
+        }
+        idle.fetch_add(1);
+        wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+        idle.fetch_sub(1);
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::popOwn(unsigned index, std::function<void()>& task) {
+    Queue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(unsigned thief, std::function<void()>& task) {
+    for (unsigned offset = 1; offset < size(); ++offset) {
+        Queue& queue = *queues[(thief + offset) % size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(std::function<void()>& task) {
+    try {
+        task();
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        if (!firstError) {
+            firstError = std::current_exception();
+        }
+    }
+    task = nullptr;
+
+    if (pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        finished.notify_all();
+    }
+}
\ No newline at end of file